@@ -0,0 +1,45 @@
+// アルファベットにない文字の扱いを確かめるテスト。失敗するとassertで止まる。
+//   g++ -O2 -o alphabet_test alphabet_test.cpp && ./alphabet_test
+#undef NDEBUG
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include "letters.hpp"
+#include "score_index.hpp"
+#include "score_trie.hpp"
+using namespace std;
+
+int main(){
+
+    // イタリア語の表には j, k, w, x, y がない。
+    // "jazz" は j を無視すると "azz" で作れてしまうので、辞書に入れてはいけない。
+    vector<string> words = {"jazz", "zaza", "az"};
+    assert(!is_valid_word<ItalianAlphabet>("jazz"));
+    assert(is_valid_word<ItalianAlphabet>("zaza"));
+    assert(is_valid_word<EnglishAlphabet>("jazz"));
+    assert(!is_valid_rack<ItalianAlphabet>("ajzz"));
+    assert(is_valid_rack<ItalianAlphabet>("a?zz"));
+
+    BasicScoreTrie<ItalianAlphabet> trie;
+    trie.build(words);
+    assert(trie.size() == 2);
+    assert(trie.find_word("jazz") == -1);
+    assert(trie.word(trie.find_best("azz")) == "az");
+    assert(trie.word(trie.find_best("azza")) == "zaza");
+
+    BasicScoreIndex<ItalianAlphabet> index;
+    index.build(words);
+    assert(index.word(index.find_best("azz")) == "az");
+    assert(index.word(index.find_best("azza")) == "zaza");
+    assert(index.find_top("azz", 0, 0).size() == 1);
+
+    // 英語の表では "jazz" もふつうの単語
+    BasicScoreTrie<EnglishAlphabet> english;
+    english.build(words);
+    assert(english.word(english.find_best("jazz")) == "jazz");
+
+    cout << "OK" << endl;
+    return 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "query_io.hpp"
+
+// 使うスレッド数。|requested| が0以下ならCPUのコア数。
+inline int get_num_of_threads(int requested)
+{
+    if (requested > 0)
+        return requested;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// |queries| を |num_of_threads| 個のスレッドで分担して解く。
+// |solve_one|(query, out) はqueryの答えをoutに追記する関数。
+// 答えはBATCH_CHUNK個のクエリごとにまとめた文字列として、入力と同じ順に返す。
+// 辞書は読み出し専用で共有するので、|solve_one| はconstな処理だけを行うこと。
+constexpr size_t BATCH_CHUNK = 64;
+
+template <class Solve>
+std::vector<std::string> solve_batch(const std::vector<std::string_view> &queries, int num_of_threads, Solve solve_one)
+{
+    // 1件ずつ取り合うと競合が増えるので、ある程度まとめて取る
+    std::vector<std::string> answers((queries.size() + BATCH_CHUNK - 1) / BATCH_CHUNK);
+    std::atomic<size_t> next(0);
+
+    auto worker = [&]()
+    {
+        while (true)
+        {
+            size_t chunk = next.fetch_add(1);
+            if (chunk >= answers.size())
+                break;
+            size_t first = chunk * BATCH_CHUNK;
+            size_t last = std::min(first + BATCH_CHUNK, queries.size());
+            for (size_t i = first; i < last; ++i)
+                solve_one(queries[i], answers[chunk]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_of_threads; ++t)
+        threads.emplace_back(worker);
+    worker(); // メインスレッドも働く
+    for (std::thread &thread : threads)
+        thread.join();
+    return answers;
+}
+
+// |reader| のクエリをすべて解いて標準出力に書き出す。
+// |num_of_threads| が1より大きければ、すべて読んでからsolve_batch()で分担して解く。
+template <class Solve>
+void answer_queries(QueryReader &reader, int num_of_threads, Solve solve_one)
+{
+    OutputBuffer out;
+    if (num_of_threads > 1)
+    {
+        for (const std::string &answer : solve_batch(reader.read_all(), num_of_threads, solve_one))
+            out.write(answer);
+        return;
+    }
+    std::string_view query;
+    while (reader.next(query))
+    {
+        solve_one(query, out.buffer());
+        // 入力待ちになる前に、それまでの答えを書き出しておく
+        if (!reader.has_buffered())
+            out.flush();
+        else
+            out.flush_if_full();
+    }
+}
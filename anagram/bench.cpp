@@ -0,0 +1,217 @@
+// src01/src02のエンジンの速さを測るベンチマーク。
+//   g++ -O2 -o bench bench.cpp
+//   ./bench [--engine=sorted|trie|index|all] [--data=DIR] [--repeat=N] [--histogram=FILE]
+// DIR/words.txt から索引を作る時間と、DIR/{small,medium,large,task1}.txt の各クエリの
+// 処理時間(1秒あたりのクエリ数、p50/p99/最大の遅延)、クエリごとに調べた辞書の項目数を表示する。
+// --histogram を指定すると、調べた項目数のヒストグラムをCSVで書き出す。
+#define ANAGRAM_STATS 1
+
+#include <iostream>
+#include <fstream>
+#include <tuple>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include "sorted_index.hpp"
+#include "score_index.hpp"
+#include "score_trie.hpp"
+#include "stats.hpp"
+using namespace std;
+using Clock = chrono::steady_clock;
+
+const vector<string> QUERY_FILES = {"small", "medium", "large", "task1"};
+
+// 1つのクエリファイルの計測結果
+struct Result {
+    vector<uint64_t> latencies;   // クエリ -> 処理時間(ns)
+    vector<uint64_t> examined;    // クエリ -> 調べた辞書の項目数
+    uint64_t total_ns = 0;
+};
+
+// ファイルを1行ずつ読む。開けなければfalse。
+bool read_lines(const string &filepath, vector<string> &lines){
+    ifstream ifs(filepath);
+    if (!ifs) return false;
+    string str;
+    while (getline(ifs, str)) {
+        if (!str.empty() && str.back() == '\r') str.pop_back();
+        lines.push_back(str);
+    }
+    return true;
+}
+
+// ソート済みの |values| の |p| 分位点
+uint64_t percentile(const vector<uint64_t> &values, double p){
+    if (values.empty()) return 0;
+    size_t i = min(values.size() - 1, (size_t)(p * values.size()));
+    return values[i];
+}
+
+// 2のべき乗ごとのバケツ: 0, 1, 2-3, 4-7, ...
+int bucket_of(uint64_t n){
+    int b = 0;
+    while (n > 0) {
+        ++b;
+        n >>= 1;
+    }
+    return b;
+}
+
+// |queries| を |repeat| 回 |solve_one| で解いて測る
+Result measure(const vector<string> &queries, int repeat, const function<void(string_view, string &)> &solve_one){
+    Result result;
+    string out;
+    for (int r = 0; r < repeat; ++r) {
+        for (const string &query : queries) {
+            out.clear();
+            uint64_t before = examined_entries;
+            Clock::time_point start = Clock::now();
+            solve_one(query, out);
+            uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+            result.latencies.push_back(ns);
+            result.examined.push_back(examined_entries - before);
+            result.total_ns += ns;
+        }
+    }
+    return result;
+}
+
+// 1行にまとめて表示し、ヒストグラムを |histogram| に追記する
+void report(const string &engine, const string &name, Result &result, ostream *histogram){
+    sort(result.latencies.begin(), result.latencies.end());
+    sort(result.examined.begin(), result.examined.end());
+    size_t n = result.latencies.size();
+    double qps = result.total_ns > 0 ? n * 1e9 / result.total_ns : 0;
+    uint64_t examined_sum = 0;
+    for (uint64_t e : result.examined) examined_sum += e;
+
+    cout << left << setw(8) << engine << setw(8) << name << right
+         << setw(8) << n
+         << setw(12) << fixed << setprecision(0) << qps
+         << setw(10) << setprecision(2) << percentile(result.latencies, 0.50) / 1000.0
+         << setw(10) << percentile(result.latencies, 0.99) / 1000.0
+         << setw(10) << (n > 0 ? result.latencies.back() / 1000.0 : 0.0)
+         << setw(12) << setprecision(1) << (n > 0 ? (double)examined_sum / n : 0.0)
+         << setw(10) << percentile(result.examined, 0.50)
+         << setw(10) << percentile(result.examined, 0.99)
+         << setw(10) << (n > 0 ? result.examined.back() : 0) << endl;
+
+    if (histogram) {
+        vector<uint64_t> buckets;
+        for (uint64_t e : result.examined) {
+            int b = bucket_of(e);
+            if ((int)buckets.size() <= b) buckets.resize(b + 1, 0);
+            ++buckets[b];
+        }
+        for (size_t b = 0; b < buckets.size(); ++b) {
+            if (buckets[b] == 0) continue;
+            uint64_t lo = b == 0 ? 0 : 1ull << (b - 1), hi = b == 0 ? 0 : (1ull << b) - 1;
+            *histogram << engine << ',' << name << ',' << lo << ',' << hi << ',' << buckets[b] << '\n';
+        }
+    }
+}
+
+int main(int argc, char *argv[]){
+
+    // オプション
+    string engine = "all";
+    string data_dir = "input_data";
+    int repeat = 1;
+    string histogram_path;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--engine=", 0) == 0) engine = arg.substr(9);
+        else if (arg.rfind("--data=", 0) == 0) data_dir = arg.substr(7);
+        else if (arg.rfind("--repeat=", 0) == 0) repeat = max(1, stoi(arg.substr(9)));
+        else if (arg.rfind("--histogram=", 0) == 0) histogram_path = arg.substr(12);
+        else {
+            cerr << "Usage: " << argv[0] << " [--engine=sorted|trie|index|all] [--data=DIR] [--repeat=N] [--histogram=FILE]" << endl;
+            return 1;
+        }
+    }
+    if (engine != "all" && engine != "sorted" && engine != "trie" && engine != "index") {
+        cerr << "Unknown engine: " << engine << endl;
+        return 1;
+    }
+
+    vector<string> words;
+    if (!read_lines(data_dir + "/words.txt", words)) {
+        cout << "File not opened." << endl;
+        return 1;
+    }
+    vector<pair<string, vector<string>>> query_files;
+    for (const string &name : QUERY_FILES) {
+        vector<string> queries;
+        if (read_lines(data_dir + "/" + name + ".txt", queries)) query_files.emplace_back(name, move(queries));
+        else cerr << "Skipped " << name << ".txt (not opened)." << endl;
+    }
+
+    ofstream histogram_file;
+    if (!histogram_path.empty()) {
+        histogram_file.open(histogram_path);
+        if (!histogram_file) {
+            cout << "Failed to open " << histogram_path << "." << endl;
+            return 1;
+        }
+        histogram_file << "engine,file,examined_min,examined_max,queries\n";
+    }
+    ostream *histogram = histogram_path.empty() ? nullptr : &histogram_file;
+
+    SortedIndex sorted_index;
+    ScoreTrie trie;
+    ScoreIndex score_index;
+    // エンジン -> (索引を作る処理, 1クエリを解く処理)。src01/src02のsolve()と同じことをする。
+    vector<tuple<string, function<void()>, function<void(string_view, string &)>>> engines = {
+        {"sorted", [&]() { sorted_index.build(words); },
+         [&](string_view query, string &out) {
+             string sig(query);
+             sort(sig.begin(), sig.end());
+             auto range = sorted_index.find(sig);
+             if (range.first == range.second) out += "NOT FOUND\n";
+             for (uint32_t id = range.first; id != range.second; ++id) {
+                 out += sorted_index.word(id);
+                 out += '\n';
+             }
+         }},
+        {"trie", [&]() { trie.build(words); },
+         [&](string_view query, string &out) {
+             int best = trie.find_best(query);
+             out += best == -1 ? "NOT FOUND" : trie.word(best);
+             out += '\n';
+         }},
+        {"index", [&]() { score_index.build(words); },
+         [&](string_view query, string &out) {
+             int best = score_index.find_best(query);
+             out += best == -1 ? "NOT FOUND" : score_index.word(best);
+             out += '\n';
+         }},
+    };
+
+    cout << "engine    build(ms)" << endl;
+    for (auto &e : engines) {
+        if (engine != "all" && engine != get<0>(e)) continue;
+        Clock::time_point start = Clock::now();
+        get<1>(e)();
+        double ms = chrono::duration_cast<chrono::microseconds>(Clock::now() - start).count() / 1000.0;
+        cout << left << setw(8) << get<0>(e) << right << setw(11) << fixed << setprecision(1) << ms << endl;
+    }
+    cout << endl;
+
+    // 遅延はμs、examinedは調べた辞書の項目の数
+    cout << left << setw(8) << "engine" << setw(8) << "file" << right
+         << setw(8) << "queries" << setw(12) << "qps"
+         << setw(10) << "p50(us)" << setw(10) << "p99(us)" << setw(10) << "max(us)"
+         << setw(12) << "exam.mean" << setw(10) << "exam.p50" << setw(10) << "exam.p99" << setw(10) << "exam.max" << endl;
+    for (auto &e : engines) {
+        if (engine != "all" && engine != get<0>(e)) continue;
+        for (const auto &file : query_files) {
+            Result result = measure(file.second, repeat, get<2>(e));
+            report(get<0>(e), file.first, result, histogram);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "letters.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ANAGRAM_X86 1
+#endif
+
+// 「|words|[i] の文字がすべて |rack| に含まれる」を満たす最初のiを返す。なければ |n|。
+// 実装はCPUに合わせて起動時に選ばれる(AVX2 -> SSE2 -> スカラー)。
+using FitKernel = size_t (*)(const LetterCounts *words, size_t n, const LetterCounts &rack);
+
+// アルファベットにない位置は常に0なので、どのカーネルも32byteすべてを比べればよく、アルファベットによらない。
+
+// スカラー版
+inline size_t first_fit_scalar(const LetterCounts *words, size_t n, const LetterCounts &rack)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        bool flg = true;
+        for (size_t c = 0; c < rack.size(); ++c)
+        {
+            if (rack[c] < words[i][c])
+            {
+                flg = false;
+                break;
+            }
+        }
+        if (flg)
+            return i;
+    }
+    return n;
+}
+
+#ifdef ANAGRAM_X86
+
+// SSE2版: 16byteずつ2回に分けて、飽和減算 word - rack がすべて0になるかを見る
+inline size_t first_fit_sse2(const LetterCounts *words, size_t n, const LetterCounts &rack)
+{
+    const __m128i r0 = _mm_loadu_si128((const __m128i *)rack.data());
+    const __m128i r1 = _mm_loadu_si128((const __m128i *)(rack.data() + 16));
+    const __m128i zero = _mm_setzero_si128();
+    for (size_t i = 0; i < n; ++i)
+    {
+        __m128i d = _mm_or_si128(
+            _mm_subs_epu8(_mm_loadu_si128((const __m128i *)words[i].data()), r0),
+            _mm_subs_epu8(_mm_loadu_si128((const __m128i *)(words[i].data() + 16)), r1));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(d, zero)) == 0xFFFF)
+            return i;
+    }
+    return n;
+}
+
+// AVX2版: 4単語ずつまとめて判定する
+__attribute__((target("avx2"))) inline size_t first_fit_avx2(const LetterCounts *words, size_t n, const LetterCounts &rack)
+{
+    const __m256i r = _mm256_loadu_si256((const __m256i *)rack.data());
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i d0 = _mm256_subs_epu8(_mm256_loadu_si256((const __m256i *)words[i].data()), r);
+        __m256i d1 = _mm256_subs_epu8(_mm256_loadu_si256((const __m256i *)words[i + 1].data()), r);
+        __m256i d2 = _mm256_subs_epu8(_mm256_loadu_si256((const __m256i *)words[i + 2].data()), r);
+        __m256i d3 = _mm256_subs_epu8(_mm256_loadu_si256((const __m256i *)words[i + 3].data()), r);
+        // どれか1つでも作れるなら、バイトごとのminはすべて0になる。
+        // ほとんどの場合どれも作れないので、まずminでまとめて調べる。
+        __m256i m = _mm256_min_epu8(_mm256_min_epu8(d0, d1), _mm256_min_epu8(d2, d3));
+        if (!_mm256_testz_si256(m, m))
+            continue;
+        if (_mm256_testz_si256(d0, d0))
+            return i;
+        if (_mm256_testz_si256(d1, d1))
+            return i + 1;
+        if (_mm256_testz_si256(d2, d2))
+            return i + 2;
+        if (_mm256_testz_si256(d3, d3))
+            return i + 3;
+    }
+    for (; i < n; ++i)
+    {
+        __m256i d = _mm256_subs_epu8(_mm256_loadu_si256((const __m256i *)words[i].data()), r);
+        if (_mm256_testz_si256(d, d))
+            return i;
+    }
+    return n;
+}
+
+#endif
+
+// CPUに合ったカーネルを選ぶ
+inline FitKernel select_fit_kernel()
+{
+#ifdef ANAGRAM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return first_fit_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return first_fit_sse2;
+#endif
+    return first_fit_scalar;
+}
+
+// 起動時に一度だけ選んだカーネル
+inline const FitKernel first_fit = select_fit_kernel();
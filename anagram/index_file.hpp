@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include "mapped_file.hpp"
+
+// 索引ファイルの形式
+//   ヘッダ: MAGIC(8byte), INDEX_VERSION(4byte), 索引の種類(4byte), アルファベットのID(4byte), 予約(4byte)
+//   その後に配列が順に並ぶ。各配列は 要素数(8byte), 要素の大きさ(8byte), 中身 で、
+//   中身はそのままmmapして読めるよう8byte境界に揃える。
+// 数値はすべて書き出したマシンのバイト順のまま。
+constexpr char INDEX_MAGIC[8] = {'A', 'N', 'A', 'G', 'R', 'A', 'M', '\0'};
+constexpr uint32_t INDEX_VERSION = 3; // 3: アルファベットにない文字を含む単語を入れなくなった
+
+// 索引ファイルに入っている索引の種類
+enum class IndexKind : uint32_t
+{
+    SORTED_INDEX = 1, // src01のSortedIndex
+    SCORE_INDEX = 2,  // src02のScoreIndex
+    SCORE_TRIE = 3,   // src02のScoreTrie
+};
+
+// 連続した配列。build()で作ったときは自分で持つvectorを、
+// 索引ファイルから読んだときはmmapした領域をそのまま指す。
+template <class T>
+class FlatArray
+{
+public:
+    void assign(std::vector<T> &&values)
+    {
+        owned = std::move(values);
+        ptr = owned.data();
+        len = owned.size();
+    }
+
+    // |p| から |n| 個をコピーせずに指す(|p| の寿命は呼び出し側が保証する)
+    void attach(const T *p, size_t n)
+    {
+        owned.clear();
+        owned.shrink_to_fit();
+        ptr = p;
+        len = n;
+    }
+
+    const T &operator[](size_t i) const
+    {
+        return ptr[i];
+    }
+    const T *data() const
+    {
+        return ptr;
+    }
+    size_t size() const
+    {
+        return len;
+    }
+    bool empty() const
+    {
+        return len == 0;
+    }
+    const T *begin() const
+    {
+        return ptr;
+    }
+    const T *end() const
+    {
+        return ptr + len;
+    }
+
+private:
+    std::vector<T> owned;
+    const T *ptr = nullptr;
+    size_t len = 0;
+};
+
+// 索引ファイルを書き出す
+class IndexWriter
+{
+public:
+    // |alphabet_id|: 索引が使うアルファベット(letters.hpp)のID。文字をそのまま扱う索引なら0。
+    IndexWriter(const std::string &filepath, IndexKind kind, uint32_t alphabet_id = 0)
+        : ofs(filepath, std::ios::binary)
+    {
+        uint32_t header[4] = {INDEX_VERSION, (uint32_t)kind, alphabet_id, 0};
+        ofs.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        ofs.write((const char *)header, sizeof(header));
+    }
+
+    template <class T>
+    void write(const FlatArray<T> &array)
+    {
+        uint64_t header[2] = {array.size(), sizeof(T)};
+        ofs.write((const char *)header, sizeof(header));
+        ofs.write((const char *)array.data(), array.size() * sizeof(T));
+        // 8byte境界に揃える
+        static const char zeros[8] = {0};
+        size_t padding = (8 - array.size() * sizeof(T) % 8) % 8;
+        ofs.write(zeros, padding);
+    }
+
+    // 書き込みに成功したか
+    bool good() const
+    {
+        return ofs.good();
+    }
+
+private:
+    std::ofstream ofs;
+};
+
+// mmapした索引ファイルを先頭から順に読む。中身はコピーせずFlatArrayに指させる。
+class IndexReader
+{
+public:
+    // |file| がアルファベット |alphabet_id| で作った |kind| の索引ファイルならtrue
+    bool open(const MappedFile &file, IndexKind kind, uint32_t alphabet_id = 0)
+    {
+        uint32_t header[4]; // INDEX_VERSION, 索引の種類, アルファベットのID, 予約
+        const size_t header_size = sizeof(INDEX_MAGIC) + sizeof(header);
+        if (file.size() < header_size || std::memcmp(file.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+            return false;
+        std::memcpy(header, file.data() + sizeof(INDEX_MAGIC), sizeof(header));
+        if (header[0] != INDEX_VERSION || header[1] != (uint32_t)kind || header[2] != alphabet_id)
+            return false;
+        cur = file.data() + header_size;
+        end = file.data() + file.size();
+        return true;
+    }
+
+    // 次の配列を |array| に指させる。壊れていたらfalse。
+    template <class T>
+    bool read(FlatArray<T> &array)
+    {
+        uint64_t header[2];
+        if ((size_t)(end - cur) < sizeof(header))
+            return false;
+        std::memcpy(header, cur, sizeof(header));
+        cur += sizeof(header);
+        if (header[1] != sizeof(T) || header[0] > (size_t)(end - cur) / sizeof(T))
+            return false;
+        size_t bytes = header[0] * sizeof(T);
+        array.attach((const T *)cur, header[0]);
+        cur += std::min((size_t)(end - cur), bytes + (8 - bytes % 8) % 8);
+        return true;
+    }
+
+private:
+    const char *cur = nullptr;
+    const char *end = nullptr;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <string_view>
+#include <array>
+#include <cstdint>
+
+// アルファベット(使う文字とそのスコア)。エンジンはこれをテンプレート引数に取るので、
+// 文字の種類やスコアはすべてコンパイル時に決まり、ループも展開される。
+// |Table| には次のものを用意する。
+//   LETTERS: 使う文字を並べた文字列(32文字以下)
+//   SCORE[i]: LETTERS[i] のスコア
+//   ID: 索引ファイルに書いておく番号(アルファベットごとに変える)
+template <class Table>
+struct Alphabet : Table
+{
+    static constexpr int SIZE = sizeof(Table::LETTERS) - 1;
+    static_assert(SIZE <= 32, "LetterCounts holds at most 32 letters.");
+
+    // 文字 -> 番号。アルファベットにない文字なら -1。
+    static constexpr std::array<int8_t, 256> make_index()
+    {
+        std::array<int8_t, 256> index = {0};
+        for (int c = 0; c < 256; ++c)
+            index[c] = -1;
+        for (int i = 0; i < SIZE; ++i)
+            index[(unsigned char)Table::LETTERS[i]] = i;
+        return index;
+    }
+    static constexpr std::array<int8_t, 256> INDEX = make_index();
+
+    static constexpr int index(char c)
+    {
+        return INDEX[(unsigned char)c];
+    }
+
+    // スコアの高い(=珍しい)文字から並べた順番(同点ならLETTERSの順)
+    static constexpr std::array<int, SIZE> make_order()
+    {
+        std::array<int, SIZE> order = {0};
+        for (int i = 0; i < SIZE; ++i)
+        {
+            int d = i;
+            while (d > 0 && Table::SCORE[order[d - 1]] < Table::SCORE[i])
+            {
+                order[d] = order[d - 1];
+                --d;
+            }
+            order[d] = i;
+        }
+        return order;
+    }
+    static constexpr std::array<int, SIZE> ORDER = make_order();
+
+    // ORDER_MASK[d]: ORDER[0], ..., ORDER[d - 1] の文字の集合
+    static constexpr std::array<uint32_t, SIZE + 1> make_order_mask()
+    {
+        std::array<uint32_t, SIZE + 1> mask = {0};
+        for (int d = 0; d < SIZE; ++d)
+            mask[d + 1] = mask[d] | 1u << ORDER[d];
+        return mask;
+    }
+    static constexpr std::array<uint32_t, SIZE + 1> ORDER_MASK = make_order_mask();
+};
+
+//各アルファベットのスコア(英語のScrabble)
+struct EnglishTable
+{
+    static constexpr char LETTERS[] = "abcdefghijklmnopqrstuvwxyz";
+    static constexpr int SCORE[26] = {
+        1,3,2,2,1,3,3,1,1,4,4,2,2,1,1,3,4,1,1,1,2,3,3,4,3,4
+    };
+    static constexpr uint32_t ID = 1;
+};
+using EnglishAlphabet = Alphabet<EnglishTable>;
+
+// どの文字も1点(スコア = 単語の長さ)
+struct UnitTable
+{
+    static constexpr char LETTERS[] = "abcdefghijklmnopqrstuvwxyz";
+    static constexpr int SCORE[26] = {
+        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1
+    };
+    static constexpr uint32_t ID = 2;
+};
+using UnitAlphabet = Alphabet<UnitTable>;
+
+// イタリア語のScrabble(j, k, w, x, yの牌はない)
+struct ItalianTable
+{
+    static constexpr char LETTERS[] = "abcdefghilmnopqrstuvz";
+    static constexpr int SCORE[21] = {
+        1,5,2,5,1,5,8,8,1,3,3,3,1,5,10,2,2,2,3,5,8
+    };
+    static constexpr uint32_t ID = 3;
+};
+using ItalianAlphabet = Alphabet<ItalianTable>;
+
+// ラックの空白牌。どの文字の代わりにもなるが0点。
+constexpr char BLANK = '?';
+
+// 単語(またはクエリ)の文字の出現回数。アルファベットの番号順に並ぶ。
+// SIMDで1命令で比較できるよう32byteにしてあり、アルファベットにない位置は常に0。
+using LetterCounts = std::array<uint8_t, 32>;
+
+// |str| の各文字の出現回数と、現れる文字の集合(ビットマスク)を求める。アルファベットにない文字は無視する。
+template <class A = EnglishAlphabet>
+inline uint32_t count_letters(std::string_view str, LetterCounts &counts)
+{
+    counts.fill(0);
+    uint32_t mask = 0;
+    for (char c : str)
+    {
+        int i = A::index(c);
+        if (i < 0)
+            continue;
+        if (counts[i] < 255)
+            ++counts[i];
+        mask |= 1u << i;
+    }
+    return mask;
+}
+
+// 出現回数から求めたスコア
+template <class A = EnglishAlphabet>
+inline int get_score(const LetterCounts &counts)
+{
+    int score = 0;
+    for (int i = 0; i < A::SIZE; ++i)
+        score += counts[i] * A::SCORE[i];
+    return score;
+}
+
+// 出現回数から求めた文字の集合
+template <class A = EnglishAlphabet>
+inline uint32_t get_mask(const LetterCounts &counts)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < A::SIZE; ++i)
+    {
+        if (counts[i] > 0)
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+// |rack| に含まれる空白牌の数
+inline int count_blanks(std::string_view rack)
+{
+    int blanks = 0;
+    for (char c : rack)
+    {
+        if (c == BLANK)
+            ++blanks;
+    }
+    return blanks;
+}
+
+// |word| を |rack| で作るのに足りない文字の数(= 必要な空白牌の数)
+template <class A = EnglishAlphabet>
+inline int count_missing(const LetterCounts &word, const LetterCounts &rack)
+{
+    int missing = 0;
+    for (int i = 0; i < A::SIZE; ++i)
+    {
+        if (rack[i] < word[i])
+            missing += word[i] - rack[i];
+    }
+    return missing;
+}
+
+// |word| を |rack| で作ったときのスコア。足りない文字は空白牌で補うので0点。
+template <class A = EnglishAlphabet>
+inline int get_score_with_rack(const LetterCounts &word, const LetterCounts &rack)
+{
+    int score = 0;
+    for (int i = 0; i < A::SIZE; ++i)
+        score += (word[i] < rack[i] ? word[i] : rack[i]) * A::SCORE[i];
+    return score;
+}
+
+// アルファベットの文字だけからなる空でない文字列か(辞書の単語や、追加・削除する単語に使う)
+template <class A = EnglishAlphabet>
+inline bool is_valid_word(std::string_view str)
+{
+    if (str.empty())
+        return false;
+    for (char c : str)
+    {
+        if (A::index(c) < 0)
+            return false;
+    }
+    return true;
+}
+
+// アルファベットの文字と空白牌だけからなるラックか。空のラックは何も作れないだけなので受け付ける。
+template <class A = EnglishAlphabet>
+inline bool is_valid_rack(std::string_view rack)
+{
+    for (char c : rack)
+    {
+        if (c != BLANK && A::index(c) < 0)
+            return false;
+    }
+    return true;
+}
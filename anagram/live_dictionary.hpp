@@ -0,0 +1,210 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include "letters.hpp"
+#include "sorted_index.hpp"
+#include "score_trie.hpp"
+
+// 索引は作り直さずに、追加・削除した単語を索引の外に持っておく辞書。
+// 索引の単語のうち削除されたものは集合に記録して検索時に飛ばし、追加された単語は別に調べる。
+
+// src01用: シグネチャから単語を引く
+class LiveAnagramDictionary
+{
+public:
+    explicit LiveAnagramDictionary(const SortedIndex &index)
+        : index(index)
+    {
+    }
+
+    // シグネチャ |sig| を持つ単語を辞書順(追加された単語は最後)にすべて返す
+    std::vector<std::string_view> find(std::string_view sig) const
+    {
+        std::vector<std::string_view> found;
+        auto range = index.find(sig);
+        for (uint32_t id = range.first; id != range.second; ++id)
+        {
+            if (!removed.count(id))
+                found.push_back(index.word(id));
+        }
+        auto itr = added.find(std::string(sig));
+        if (itr != added.end())
+            found.insert(found.end(), itr->second.begin(), itr->second.end());
+        return found;
+    }
+
+    // |word| を追加する。すでにあればfalse。
+    bool add(std::string_view word)
+    {
+        std::string sig = get_signature(word);
+        int id = find_in_index(sig, word);
+        if (id != -1)
+            return removed.erase(id) > 0;
+        std::vector<std::string> &words = added[sig];
+        if (std::find(words.begin(), words.end(), word) != words.end())
+            return false;
+        words.emplace_back(word);
+        return true;
+    }
+
+    // |word| を削除する。なければfalse。
+    bool remove(std::string_view word)
+    {
+        std::string sig = get_signature(word);
+        int id = find_in_index(sig, word);
+        if (id != -1)
+            return removed.insert(id).second;
+        auto itr = added.find(sig);
+        if (itr == added.end())
+            return false;
+        auto found = std::find(itr->second.begin(), itr->second.end(), word);
+        if (found == itr->second.end())
+            return false;
+        itr->second.erase(found);
+        if (itr->second.empty())
+            added.erase(itr);
+        return true;
+    }
+
+    static std::string get_signature(std::string_view word)
+    {
+        std::string sig(word);
+        std::sort(sig.begin(), sig.end());
+        return sig;
+    }
+
+private:
+    // 索引の中の |word| のid。なければ -1。
+    int find_in_index(const std::string &sig, std::string_view word) const
+    {
+        auto range = index.find(sig);
+        for (uint32_t id = range.first; id != range.second; ++id)
+        {
+            if (index.word(id) == word)
+                return id;
+        }
+        return -1;
+    }
+
+    const SortedIndex &index;
+    std::unordered_set<uint32_t> removed;                          // 削除された索引の単語
+    std::unordered_map<std::string, std::vector<std::string>> added; // シグネチャ -> 追加された単語
+};
+
+// src02用: ラックで作れる最もスコアの高い単語を引く
+template <class Alphabet>
+class LiveScoreDictionary
+{
+public:
+    explicit LiveScoreDictionary(const BasicScoreTrie<Alphabet> &trie)
+        : trie(trie)
+    {
+    }
+
+    // |rack| で作れる最もスコアの高い単語。なければ空。空白牌の扱いはBasicScoreTrie::find_best()と同じ。
+    // 同点なら辞書で先の単語、追加された単語はどの辞書の単語よりも後(追加順)とみなす。
+    std::string_view find_best(std::string_view rack) const
+    {
+        int best = removed.empty() ? trie.find_best(rack)
+                                   : trie.find_best(rack, [&](uint32_t e)
+                                                    { return removed.count(e) > 0; });
+        LetterCounts rack_counts;
+        uint32_t rack_mask = count_letters<Alphabet>(rack, rack_counts);
+        int blanks = count_blanks(rack);
+        std::string_view best_word;
+        int best_score = -1;
+        const AddedWord *best_added = nullptr;
+        if (best != -1)
+        {
+            best_word = trie.word(best);
+            LetterCounts counts;
+            count_letters<Alphabet>(best_word, counts);
+            best_score = get_score_with_rack<Alphabet>(counts, rack_counts);
+        }
+
+        // 追加された単語はスコアの高い順に並んでいて、空白牌を使うと実際のスコアは単語のスコア以下になるので、
+        // 単語のスコアが今の最高を下回ったら打ち切れる
+        for (const AddedWord &added_word : added)
+        {
+            if (added_word.score < best_score)
+                break;
+            if (__builtin_popcount(added_word.mask & ~rack_mask) > blanks ||
+                count_missing<Alphabet>(added_word.counts, rack_counts) > blanks)
+                continue;
+            int score = get_score_with_rack<Alphabet>(added_word.counts, rack_counts);
+            // 同点なら辞書の単語、追加された単語どうしなら先に追加したもの
+            if (score > best_score || (score == best_score && best_added != nullptr && added_word.order < best_added->order))
+            {
+                best_word = added_word.word;
+                best_score = score;
+                best_added = &added_word;
+            }
+        }
+        return best_word;
+    }
+
+    // |word| を追加する。すでにあればfalse。
+    // 索引は作り直さず、追加された単語の列にスコア順を保って挿入する。
+    bool add(std::string_view word)
+    {
+        int e = trie.find_word(word);
+        if (e != -1)
+            return removed.erase(e) > 0;
+        if (!added_words.emplace(word).second)
+            return false;
+        AddedWord added_word;
+        added_word.word = word;
+        added_word.mask = count_letters<Alphabet>(word, added_word.counts);
+        added_word.score = get_score<Alphabet>(added_word.counts);
+        added_word.order = num_of_added++;
+        // 同じスコアの中では追加順(今のものが最後)
+        auto place = std::upper_bound(added.begin(), added.end(), added_word.score, [](int score, const AddedWord &other)
+                                      { return score > other.score; });
+        added.insert(place, std::move(added_word));
+        return true;
+    }
+
+    // |word| を削除する。なければfalse。
+    bool remove(std::string_view word)
+    {
+        int e = trie.find_word(word);
+        if (e != -1)
+            return removed.insert(e).second;
+        auto found = added_words.find(std::string(word));
+        if (found == added_words.end())
+            return false;
+        added_words.erase(found);
+        added.erase(std::find_if(added.begin(), added.end(), [&](const AddedWord &added_word)
+                                 { return added_word.word == word; }));
+        return true;
+    }
+
+    static int word_score(std::string_view word)
+    {
+        LetterCounts counts;
+        count_letters<Alphabet>(word, counts);
+        return get_score<Alphabet>(counts);
+    }
+
+private:
+    struct AddedWord
+    {
+        std::string word;
+        LetterCounts counts;
+        uint32_t mask;  // 含まれる文字の集合
+        int score;
+        uint64_t order; // 追加した順番
+    };
+
+    const BasicScoreTrie<Alphabet> &trie;
+    std::unordered_set<uint32_t> removed;        // 削除されたトライ木の単語の番号
+    std::vector<AddedWord> added;                // 追加された単語(スコアの高い順、同点なら追加順)
+    std::unordered_set<std::string> added_words; // 追加された単語(あるかどうかを引く)
+    uint64_t num_of_added = 0;                   // これまでに追加した単語の数
+};
+
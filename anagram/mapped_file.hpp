@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 読み出し専用でメモリにマップしたファイル
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile()
+    {
+        close();
+    }
+
+    // |filepath| をマップする。失敗したらfalse。
+    bool open(const std::string &filepath)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size))
+        {
+            close();
+            return false;
+        }
+        length = file_size.QuadPart;
+        if (length == 0)
+            return true;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+        {
+            close();
+            return false;
+        }
+        address = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (address == nullptr)
+        {
+            close();
+            return false;
+        }
+#else
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        length = st.st_size;
+        if (length > 0)
+        {
+            void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            address = (const char *)p;
+        }
+        ::close(fd); // マップした後はファイルを閉じてよい
+#endif
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (address != nullptr)
+            UnmapViewOfFile(address);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (address != nullptr)
+            munmap((void *)address, length);
+#endif
+        address = nullptr;
+        length = 0;
+    }
+
+    const char *data() const
+    {
+        return address;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    const char *address = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include "letters.hpp"
+
+// シグネチャ(ソート済みの文字列)の「1文字違い」を列挙する。
+// 単語の並べ替えを無視した編集距離1、つまり1文字の削除・挿入・置換で作れるシグネチャを、
+// 重複なく |visit|(シグネチャ) に渡す。挿入・置換に使う文字はEnglishAlphabetの文字。
+// 辞書を走査せず、出てきたシグネチャをSortedIndexのハッシュ表で引けばよい(高々 27n + 26 回)。
+template <class Visit>
+void for_each_near_signature(std::string_view sig, Visit visit)
+{
+    using A = EnglishAlphabet;
+    std::string near;
+
+    // 削除: 同じ文字が続くときはどれを消しても同じなので先頭だけ
+    for (size_t i = 0; i < sig.size(); ++i)
+    {
+        if (i > 0 && sig[i] == sig[i - 1])
+            continue;
+        near.assign(sig.substr(0, i));
+        near.append(sig.substr(i + 1));
+        visit(std::string_view(near));
+    }
+
+    // 置換: 文字 sig[i] を別の文字に変える。削除した上でソート順の位置に挿入する。
+    std::string removed;
+    for (size_t i = 0; i < sig.size(); ++i)
+    {
+        if (i > 0 && sig[i] == sig[i - 1])
+            continue;
+        removed.assign(sig.substr(0, i));
+        removed.append(sig.substr(i + 1));
+        for (int k = 0; k < A::SIZE; ++k)
+        {
+            char c = A::LETTERS[k];
+            if (c == sig[i])
+                continue;
+            size_t pos = std::upper_bound(removed.begin(), removed.end(), c) - removed.begin();
+            near.assign(removed);
+            near.insert(near.begin() + pos, c);
+            visit(std::string_view(near));
+        }
+    }
+
+    // 挿入
+    for (int k = 0; k < A::SIZE; ++k)
+    {
+        char c = A::LETTERS[k];
+        size_t pos = std::upper_bound(sig.begin(), sig.end(), c) - sig.begin();
+        near.assign(sig);
+        near.insert(near.begin() + pos, c);
+        visit(std::string_view(near));
+    }
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "letters.hpp"
+#include "fit_kernel.hpp"
+#include "sorted_index.hpp"
+#include "score_index.hpp"
+
+// ラックの文字をちょうど使い切る単語の組み合わせ(フレーズ)を探す。
+// 同じシグネチャの単語はまとめて1つの候補として扱う。
+// 候補はクエリごとに「長い順(同じ長さならSortedIndexのid順)」に並べ、フレーズの中でもこの順に並ぶものだけを数える。
+// 候補は必要になった分だけ順に試すので、|limit| 個見つかった時点で探索は止まる。
+// 行き止まりを避けるため「残りのラック -> 使い切れるか」をハッシュ表にメモする。
+// 使い切れるかは最初に見つかったフレーズで決まるので、候補のリストは作らない。
+// メモは MAX_MEMO_SIZE 個を超えたら捨てて作り直す(メモリを抑えるため。答えは変わらない)。
+class PhraseSearch
+{
+public:
+    PhraseSearch(const SortedIndex &sorted_index, const ScoreIndex &score_index)
+        : sorted_index(sorted_index), score_index(score_index)
+    {
+    }
+
+    // |min_length| 文字より短い単語は使わない
+    void set_min_length(size_t length)
+    {
+        min_length = length;
+    }
+
+    // |rack| の文字をちょうど使い切るフレーズを最大 |limit| 個、|out| に1行ずつ追記する。
+    // 単語の並べ替えだけが違うフレーズは1つとみなす。見つかった個数を返す。
+    size_t find(std::string_view rack, size_t limit, std::string &out)
+    {
+        LetterCounts counts;
+        count_letters(rack, counts);
+        if (is_empty(counts))
+            return 0;
+
+        // ラックで作れる単語をシグネチャごとにまとめて候補にする
+        candidates.clear();
+        for (uint32_t e : score_index.find_top(counts, 0))
+        {
+            if (score_index.word(e).size() < min_length)
+                continue;
+            std::string sig(score_index.word(e));
+            std::sort(sig.begin(), sig.end());
+            candidates.push_back(sorted_index.find(sig).first);
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](uint32_t l, uint32_t r)
+                  {
+                      size_t l_length = sorted_index.signature(l).size(), r_length = sorted_index.signature(r).size();
+                      return l_length != r_length ? l_length > r_length : l < r;
+                  });
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        candidate_counts.resize(candidates.size());
+        for (size_t i = 0; i < candidates.size(); ++i)
+            count_letters(sorted_index.signature(candidates[i]), candidate_counts[i]);
+
+        // 候補がクエリごとに変わるのでメモも作り直す
+        memo.clear();
+        std::vector<uint32_t> path;
+        size_t found = 0;
+        enumerate(counts, 0, path, limit, found, out);
+        return found;
+    }
+
+private:
+    // LetterCountsをキーにするためのハッシュ
+    struct CountsHash
+    {
+        size_t operator()(const LetterCounts &counts) const
+        {
+            uint64_t words[4];
+            std::memcpy(words, counts.data(), sizeof(words));
+            uint64_t h = 0;
+            for (uint64_t w : words)
+                h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+            return h ^ (h >> 29);
+        }
+    };
+
+    static bool is_empty(const LetterCounts &counts)
+    {
+        for (int c = 0; c < 26; ++c)
+        {
+            if (counts[c] != 0)
+                return false;
+        }
+        return true;
+    }
+
+    static void subtract(const LetterCounts &rack, const LetterCounts &word, LetterCounts &rest)
+    {
+        for (int c = 0; c < 26; ++c)
+            rest[c] = rack[c] - word[c];
+    }
+
+    // |rack| で作れる候補のうち、番号が |from| 以上で最初のもの。なければ candidates.size()。
+    // クエリ全体の候補の中からSIMDで絞り込む。
+    size_t next_fit(const LetterCounts &rack, size_t from) const
+    {
+        size_t n = candidates.size();
+        return from >= n ? n : from + first_fit(candidate_counts.data() + from, n - from, rack);
+    }
+
+    // |rack| を使い切るフレーズがあるか
+    bool is_completable(const LetterCounts &rack)
+    {
+        auto memoized = memo.find(rack);
+        if (memoized != memo.end())
+            return memoized->second;
+
+        // 残りがそのまま1語になるなら、索引を1回引くだけでわかる
+        bool completable = false;
+        std::string sig;
+        for (int c = 0; c < 26; ++c)
+            sig.append(rack[c], 'a' + c);
+        if (sig.size() >= min_length)
+        {
+            auto range = sorted_index.find(sig);
+            completable = range.first != range.second;
+        }
+        // そうでなければ最初の単語を順に試し、使い切れるものが1つ見つかった時点でやめる
+        LetterCounts rest;
+        for (size_t i = next_fit(rack, 0); !completable && i < candidates.size(); i = next_fit(rack, i + 1))
+        {
+            subtract(rack, candidate_counts[i], rest);
+            completable = is_empty(rest) || is_completable(rest);
+        }
+
+        if (memo.size() >= MAX_MEMO_SIZE)
+            memo.clear();
+        memo.emplace(rack, completable);
+        return completable;
+    }
+
+    // |rack| を使い切るフレーズを、候補の番号が |min_index| 以上で昇順になるように列挙する
+    void enumerate(const LetterCounts &rack, uint32_t min_index, std::vector<uint32_t> &path,
+                   size_t limit, size_t &found, std::string &out)
+    {
+        LetterCounts rest;
+        for (size_t i = next_fit(rack, min_index); i < candidates.size() && found < limit; i = next_fit(rack, i + 1))
+        {
+            subtract(rack, candidate_counts[i], rest);
+            bool complete = is_empty(rest);
+            if (!complete && !is_completable(rest))
+                continue;
+            path.push_back(candidates[i]);
+            if (complete)
+                print_phrases(path, 0, "", limit, found, out);
+            else
+                enumerate(rest, i, path, limit, found, out);
+            path.pop_back();
+        }
+    }
+
+    // 候補の列 |path| を、同じシグネチャの単語の組み合わせに展開して書き出す
+    void print_phrases(const std::vector<uint32_t> &path, size_t i, const std::string &prefix,
+                       size_t limit, size_t &found, std::string &out) const
+    {
+        if (i == path.size())
+        {
+            if (found < limit)
+            {
+                out += prefix;
+                out += '\n';
+                ++found;
+            }
+            return;
+        }
+        auto range = sorted_index.find(sorted_index.signature(path[i]));
+        for (uint32_t id = range.first; id != range.second && found < limit; ++id)
+        {
+            std::string phrase = prefix;
+            if (i > 0)
+                phrase += ' ';
+            phrase += sorted_index.word(id);
+            print_phrases(path, i + 1, phrase, limit, found, out);
+        }
+    }
+
+    static constexpr size_t MAX_MEMO_SIZE = 1 << 20; // メモの上限(1項目は数十byte)
+
+    const SortedIndex &sorted_index;
+    const ScoreIndex &score_index;
+    size_t min_length = 1;
+    std::vector<uint32_t> candidates;           // 候補(SortedIndexでの範囲の先頭id)
+    std::vector<LetterCounts> candidate_counts; // 候補の文字の出現回数
+    std::unordered_map<LetterCounts, bool, CountsHash> memo; // 残りのラック -> 使い切れるか
+};
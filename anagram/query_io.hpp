@@ -0,0 +1,175 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// クエリ(空白区切りの文字列)を読む。
+// ファイルならmmapして、標準入力ならまとめて読み込んだバッファから、コピーせずstring_viewで返す。
+class QueryReader
+{
+public:
+    // クエリファイル |filepath| をmmapして読む。失敗したらfalse。
+    bool open(const std::string &filepath)
+    {
+        if (!file.open(filepath))
+            return false;
+        from_stdin = false;
+        cur = file.data();
+        end = cur + file.size();
+        eof = true;
+        return true;
+    }
+
+    // 標準入力から読む
+    void open_stdin()
+    {
+        file.close();
+        from_stdin = true;
+        buffer.assign(BLOCK_SIZE, '\0');
+        cur = end = buffer.data();
+        eof = false;
+    }
+
+    // 次のクエリを |query| に入れる。なければfalse。
+    // 標準入力のとき、|query| は次にnext()を呼ぶまでしか有効でない。
+    bool next(std::string_view &query)
+    {
+        while (true)
+        {
+            while (cur != end && is_space(*cur))
+                ++cur;
+            const char *last = cur;
+            while (last != end && !is_space(*last))
+                ++last;
+            // バッファの終わりにかかったクエリは続きがあるかもしれない
+            if (cur != end && (last != end || eof))
+            {
+                query = std::string_view(cur, last - cur);
+                cur = last;
+                return true;
+            }
+            if (eof)
+                return false;
+            refill();
+        }
+    }
+
+    // 入力を待たずに次のクエリを読める(かもしれない)ならtrue。
+    // 出力を溜めたまま入力待ちにならないよう、falseのときは先に出力を書き出すとよい。
+    bool has_buffered()
+    {
+        while (cur != end && is_space(*cur))
+            ++cur;
+        return cur != end;
+    }
+
+    // 残りのクエリをすべて読む。返すstring_viewはこのQueryReaderが生きている間有効。
+    std::vector<std::string_view> read_all()
+    {
+        if (from_stdin)
+        {
+            // EOFまで読んでからまとめて切り分ける
+            while (!eof)
+                refill();
+        }
+        std::vector<std::string_view> queries;
+        std::string_view query;
+        while (next(query))
+            queries.push_back(query);
+        return queries;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+
+    static bool is_space(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
+
+    // 標準入力から続きを読む。読み残し(途中で切れたクエリ)はバッファの先頭に移す。
+    // EOFに達したらfalse。
+    bool refill()
+    {
+        size_t rest = end - cur;
+        size_t offset = cur - buffer.data();
+        if (offset > 0)
+            std::memmove(buffer.data(), cur, rest);
+        if (buffer.size() - rest < BLOCK_SIZE)
+            buffer.resize(rest + BLOCK_SIZE);
+#ifdef _WIN32
+        int n = _read(0, buffer.data() + rest, BLOCK_SIZE);
+#else
+        ssize_t n = read(0, buffer.data() + rest, BLOCK_SIZE);
+#endif
+        cur = buffer.data();
+        end = cur + rest + (n > 0 ? n : 0);
+        if (n <= 0)
+            eof = true;
+        return n > 0;
+    }
+
+    MappedFile file;
+    std::vector<char> buffer; // 標準入力を読んだもの
+    const char *cur = nullptr;
+    const char *end = nullptr;
+    bool from_stdin = false;
+    bool eof = true;
+};
+
+// 標準出力にまとめて書き出すバッファ。
+// 行ごとにflushせず、溜まった量がFLUSH_SIZEを超えたときと最後にだけ書き出す。
+class OutputBuffer
+{
+public:
+    OutputBuffer()
+    {
+        buf.reserve(2 * FLUSH_SIZE);
+    }
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+    ~OutputBuffer()
+    {
+        flush();
+    }
+
+    // 出力を追記する先
+    std::string &buffer()
+    {
+        return buf;
+    }
+
+    void write(std::string_view str)
+    {
+        buf += str;
+        flush_if_full();
+    }
+
+    void flush_if_full()
+    {
+        if (buf.size() >= FLUSH_SIZE)
+            flush();
+    }
+
+    void flush()
+    {
+        if (!buf.empty())
+            std::fwrite(buf.data(), 1, buf.size(), stdout);
+        std::fflush(stdout);
+        buf.clear();
+    }
+
+private:
+    static constexpr size_t FLUSH_SIZE = 1 << 20;
+    std::string buf;
+};
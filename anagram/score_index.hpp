@@ -0,0 +1,363 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include "letters.hpp"
+#include "fit_kernel.hpp"
+#include "index_file.hpp"
+#include "stats.hpp"
+
+// スコア順に辿れる辞書の索引。
+// 単語は文字の集合(マスク)ごとにグループにまとめ、グループ内はスコア降順に並べる。
+// さらに各グループを「含まれる文字のうち辞書で最も出現しにくい文字」の転置リストに登録しておく。
+// クエリに含まれない文字のリストは見る必要がなく、リスト内もグループの最高スコア順なので
+// それまでに見つかった最高スコアを超えられなくなった時点で打ち切れる。
+// 文字とスコアは |Alphabet|(letters.hpp)で決まる。
+template <class Alphabet>
+class BasicScoreIndex
+{
+public:
+    // 辞書の単語から索引を作る
+    void build(const std::vector<std::string> &words)
+    {
+        // アルファベットにない文字を含む単語は作れないので入れない
+        // (count_letters()はそういう文字を無視するので、入れると別の単語として見つかってしまう)
+        std::vector<LetterCounts> word_counts(words.size());
+        std::vector<uint32_t> word_masks(words.size());
+        std::vector<int> word_scores(words.size());
+        std::array<int, Alphabet::SIZE> frequency = {0}; // 各文字を含む単語の数
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < words.size(); ++i)
+        {
+            if (!is_valid_word<Alphabet>(words[i]))
+                continue;
+            order.push_back(i);
+            word_masks[i] = count_letters<Alphabet>(words[i], word_counts[i]);
+            word_scores[i] = get_score<Alphabet>(word_counts[i]);
+            for (int c = 0; c < Alphabet::SIZE; ++c)
+            {
+                if (word_masks[i] >> c & 1)
+                    ++frequency[c];
+            }
+        }
+
+        int n = order.size();
+
+        // マスクごと、その中ではスコア降順(同点なら辞書順)に並べる
+        std::sort(order.begin(), order.end(), [&](uint32_t l, uint32_t r)
+                  {
+                      if (word_masks[l] != word_masks[r])
+                          return word_masks[l] < word_masks[r];
+                      if (word_scores[l] != word_scores[r])
+                          return word_scores[l] > word_scores[r];
+                      return l < r;
+                  });
+
+        std::vector<char> new_words_arena;
+        std::vector<uint32_t> new_offsets(1, 0);
+        std::vector<LetterCounts> new_counts;
+        std::vector<int> new_scores;
+        std::vector<uint32_t> new_ranks, new_group_begin, new_group_mask;
+        for (int e = 0; e < n; ++e)
+        {
+            uint32_t i = order[e];
+            if (e == 0 || word_masks[i] != word_masks[order[e - 1]])
+            {
+                new_group_begin.push_back(e);
+                new_group_mask.push_back(word_masks[i]);
+            }
+            new_words_arena.insert(new_words_arena.end(), words[i].begin(), words[i].end());
+            new_offsets.push_back(new_words_arena.size());
+            new_counts.push_back(word_counts[i]);
+            new_scores.push_back(word_scores[i]);
+            new_ranks.push_back(i);
+        }
+        new_group_begin.push_back(n);
+
+        // 各グループを最も出現しにくい文字の転置リストに登録する
+        int num_of_groups = new_group_mask.size();
+        std::vector<std::vector<uint32_t>> lists(Alphabet::SIZE);
+        for (int g = 0; g < num_of_groups; ++g)
+        {
+            int rarest = -1;
+            for (int c = 0; c < Alphabet::SIZE; ++c)
+            {
+                if ((new_group_mask[g] >> c & 1) && (rarest == -1 || frequency[c] < frequency[rarest]))
+                    rarest = c;
+            }
+            if (rarest != -1)
+                lists[rarest].push_back(g);
+        }
+        std::vector<uint32_t> new_list_begin(1, 0), new_list_groups;
+        for (int c = 0; c < Alphabet::SIZE; ++c)
+        {
+            // グループの最高スコア(= 先頭の単語のスコア)の降順
+            std::stable_sort(lists[c].begin(), lists[c].end(), [&](uint32_t l, uint32_t r)
+                             { return new_scores[new_group_begin[l]] > new_scores[new_group_begin[r]]; });
+            new_list_groups.insert(new_list_groups.end(), lists[c].begin(), lists[c].end());
+            new_list_begin.push_back(new_list_groups.size());
+        }
+
+        words_arena.assign(std::move(new_words_arena));
+        offsets.assign(std::move(new_offsets));
+        counts.assign(std::move(new_counts));
+        scores.assign(std::move(new_scores));
+        ranks.assign(std::move(new_ranks));
+        group_begin.assign(std::move(new_group_begin));
+        group_mask.assign(std::move(new_group_mask));
+        list_begin.assign(std::move(new_list_begin));
+        list_groups.assign(std::move(new_list_groups));
+    }
+
+    // 索引ファイルに書き出す
+    bool save(const std::string &filepath) const
+    {
+        IndexWriter writer(filepath, IndexKind::SCORE_INDEX, Alphabet::ID);
+        writer.write(words_arena);
+        writer.write(offsets);
+        writer.write(counts);
+        writer.write(scores);
+        writer.write(ranks);
+        writer.write(group_begin);
+        writer.write(group_mask);
+        writer.write(list_begin);
+        writer.write(list_groups);
+        return writer.good();
+    }
+
+    // mmapした索引ファイル |file| から読む。|file| はこの索引より長く生きていること。
+    bool load(const MappedFile &file)
+    {
+        IndexReader reader;
+        return reader.open(file, IndexKind::SCORE_INDEX, Alphabet::ID) &&
+               reader.read(words_arena) && reader.read(offsets) && reader.read(counts) &&
+               reader.read(scores) && reader.read(ranks) && reader.read(group_begin) &&
+               reader.read(group_mask) && reader.read(list_begin) && reader.read(list_groups) &&
+               list_begin.size() == Alphabet::SIZE + 1 && group_begin.size() == group_mask.size() + 1 &&
+               offsets.size() == scores.size() + 1 && counts.size() == scores.size();
+    }
+
+    // |rack| の文字で作れる最もスコアの高い単語の番号を返す。作れる単語がなければ -1。
+    // 同点の単語が複数あるときは辞書で先に出てくるものを返す。
+    // |rack| の空白牌(BLANK)は足りない文字の代わりに使え、その文字は0点になる。
+    int find_best(std::string_view rack) const
+    {
+        LetterCounts rack_counts;
+        uint32_t rack_mask = count_letters<Alphabet>(rack, rack_counts);
+        int blanks = count_blanks(rack);
+        if (blanks > 0)
+            return find_best_with_blanks(rack_counts, rack_mask, blanks);
+
+        int best = -1, best_score = 0;
+        for (int c = 0; c < Alphabet::SIZE; ++c)
+        {
+            if (!(rack_mask >> c & 1))
+                continue;
+            for (uint32_t i = list_begin[c]; i < list_begin[c + 1]; ++i)
+            {
+                uint32_t g = list_groups[i];
+                if (scores[group_begin[g]] < best_score)
+                    break; // これ以降のグループは最高スコアを超えられない
+                if (group_mask[g] & ~rack_mask)
+                    continue;
+                // グループ内はスコア降順なので、最初に作れる単語がグループ内の最高
+                uint32_t e = group_begin[g] + first_fit(&counts[group_begin[g]], group_begin[g + 1] - group_begin[g], rack_counts);
+                COUNT_EXAMINED(std::min(e + 1, group_begin[g + 1]) - group_begin[g]);
+                if (e == group_begin[g + 1])
+                    continue;
+                if (scores[e] > best_score || (scores[e] == best_score && ranks[e] < ranks[best]))
+                {
+                    best = e;
+                    best_score = scores[e];
+                }
+            }
+        }
+        return best;
+    }
+
+    // |rack| の文字で作れる単語のうちスコアが |min_score| 以上のものを、
+    // スコアの高い順(同点なら辞書順)に最大 |k| 個返す。|k| が0なら個数の制限なし。
+    // |rack| の空白牌(BLANK)はfind_best()と同じく足りない文字の代わりに使え、スコアも空白牌で補った文字を0点として比べる。
+    // 上位k個をヒープで持ち、残りのグループの最高スコアがヒープに入れなくなったら打ち切る。
+    std::vector<uint32_t> find_top(std::string_view rack, size_t k, int min_score = 0) const
+    {
+        LetterCounts rack_counts;
+        uint32_t rack_mask = count_letters<Alphabet>(rack, rack_counts);
+        int blanks = count_blanks(rack);
+        if (blanks > 0)
+            return find_top_with_blanks(rack_counts, rack_mask, blanks, k, min_score);
+        return find_top(rack_counts, k, min_score);
+    }
+
+    // 文字の出現回数 |rack_counts| で作れる単語について、find_top(rack, k, min_score)と同じものを返す(空白牌なし)
+    std::vector<uint32_t> find_top(const LetterCounts &rack_counts, size_t k, int min_score = 0) const
+    {
+        uint32_t rack_mask = get_mask<Alphabet>(rack_counts);
+
+        // ヒープの先頭が今の上位k個のうち最も悪いもの
+        auto is_better = [&](uint32_t l, uint32_t r)
+        {
+            return scores[l] > scores[r] || (scores[l] == scores[r] && ranks[l] < ranks[r]);
+        };
+        std::vector<uint32_t> heap;
+        auto is_full = [&]()
+        {
+            return k != 0 && heap.size() == k;
+        };
+
+        for (int c = 0; c < Alphabet::SIZE; ++c)
+        {
+            if (!(rack_mask >> c & 1))
+                continue;
+            for (uint32_t i = list_begin[c]; i < list_begin[c + 1]; ++i)
+            {
+                uint32_t g = list_groups[i];
+                int group_max = scores[group_begin[g]];
+                if (group_max < min_score || (is_full() && group_max < scores[heap.front()]))
+                    break; // これ以降のグループはヒープに入れない
+                if (group_mask[g] & ~rack_mask)
+                    continue;
+                uint32_t e = group_begin[g], end = group_begin[g + 1];
+                while (true)
+                {
+                    uint32_t step = first_fit(&counts[e], end - e, rack_counts);
+                    COUNT_EXAMINED(std::min(step + 1, end - e));
+                    e += step;
+                    if (e == end || scores[e] < min_score || (is_full() && !is_better(e, heap.front())))
+                        break; // グループ内もスコア降順なので、これ以降は入れない
+                    heap.push_back(e);
+                    std::push_heap(heap.begin(), heap.end(), is_better);
+                    if (k != 0 && heap.size() > k)
+                    {
+                        std::pop_heap(heap.begin(), heap.end(), is_better);
+                        heap.pop_back();
+                    }
+                    ++e;
+                }
+            }
+        }
+        std::sort_heap(heap.begin(), heap.end(), is_better);
+        return heap;
+    }
+
+    // 番号 |e| の単語
+    std::string_view word(uint32_t e) const
+    {
+        return std::string_view(words_arena.data() + offsets[e], offsets[e + 1] - offsets[e]);
+    }
+
+    // 番号 |e| の単語のスコア
+    int score(uint32_t e) const
+    {
+        return scores[e];
+    }
+
+    size_t size() const
+    {
+        return scores.size();
+    }
+
+private:
+    // 空白牌が |blanks| 個あるときのfind_best()。
+    // 空白牌で補った文字は0点なので、実際のスコアは索引のスコア以下になる。
+    // 索引のスコアを上限として打ち切れるが、グループ内で最初に作れる単語が最高とは限らないので
+    // 上限が今の最高スコアを下回るまでグループ内を順に見る。
+    int find_best_with_blanks(const LetterCounts &rack_counts, uint32_t rack_mask, int blanks) const
+    {
+        int best = -1, best_score = -1;
+        // 空白牌で補えるので、ラックにない文字のリストも見る
+        for (int c = 0; c < Alphabet::SIZE; ++c)
+        {
+            for (uint32_t i = list_begin[c]; i < list_begin[c + 1]; ++i)
+            {
+                uint32_t g = list_groups[i];
+                if (scores[group_begin[g]] < best_score)
+                    break;
+                if (__builtin_popcount(group_mask[g] & ~rack_mask) > blanks)
+                    continue;
+                for (uint32_t e = group_begin[g]; e < group_begin[g + 1] && scores[e] >= best_score; ++e)
+                {
+                    COUNT_EXAMINED(1);
+                    if (count_missing<Alphabet>(counts[e], rack_counts) > blanks)
+                        continue;
+                    int score = get_score_with_rack<Alphabet>(counts[e], rack_counts);
+                    if (score > best_score || (score == best_score && ranks[e] < ranks[best]))
+                    {
+                        best = e;
+                        best_score = score;
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+    // 空白牌が |blanks| 個あるときのfind_top()。
+    // find_best_with_blanks()と同じく索引のスコアを上限として打ち切り、グループ内は上限がヒープに入れなくなるまで順に見る。
+    // ヒープは(ラックで作ったときのスコア, 番号)で持つ。
+    std::vector<uint32_t> find_top_with_blanks(const LetterCounts &rack_counts, uint32_t rack_mask, int blanks,
+                                               size_t k, int min_score) const
+    {
+        auto is_better = [&](const std::pair<int, uint32_t> &l, const std::pair<int, uint32_t> &r)
+        {
+            return l.first > r.first || (l.first == r.first && ranks[l.second] < ranks[r.second]);
+        };
+        std::vector<std::pair<int, uint32_t>> heap;
+        // スコアの上限が |bound| の単語がヒープに入りうるか
+        auto can_enter = [&](int bound)
+        {
+            return bound >= min_score && (k == 0 || heap.size() < k || bound >= heap.front().first);
+        };
+
+        // 空白牌で補えるので、ラックにない文字のリストも見る
+        for (int c = 0; c < Alphabet::SIZE; ++c)
+        {
+            for (uint32_t i = list_begin[c]; i < list_begin[c + 1]; ++i)
+            {
+                uint32_t g = list_groups[i];
+                if (!can_enter(scores[group_begin[g]]))
+                    break;
+                if (__builtin_popcount(group_mask[g] & ~rack_mask) > blanks)
+                    continue;
+                for (uint32_t e = group_begin[g]; e < group_begin[g + 1] && can_enter(scores[e]); ++e)
+                {
+                    COUNT_EXAMINED(1);
+                    if (count_missing<Alphabet>(counts[e], rack_counts) > blanks)
+                        continue;
+                    std::pair<int, uint32_t> entry(get_score_with_rack<Alphabet>(counts[e], rack_counts), e);
+                    if (entry.first < min_score || (k != 0 && heap.size() == k && !is_better(entry, heap.front())))
+                        continue;
+                    heap.push_back(entry);
+                    std::push_heap(heap.begin(), heap.end(), is_better);
+                    if (k != 0 && heap.size() > k)
+                    {
+                        std::pop_heap(heap.begin(), heap.end(), is_better);
+                        heap.pop_back();
+                    }
+                }
+            }
+        }
+        std::sort_heap(heap.begin(), heap.end(), is_better);
+        std::vector<uint32_t> found;
+        for (const std::pair<int, uint32_t> &entry : heap)
+            found.push_back(entry.second);
+        return found;
+    }
+
+    FlatArray<char> words_arena;         // 単語を連結したもの
+    FlatArray<uint32_t> offsets;         // 番号 -> arena上の開始位置
+    FlatArray<LetterCounts> counts;      // 番号 -> 文字の出現回数(SIMDで読めるよう連続して並べる)
+    FlatArray<int> scores;               // 番号 -> スコア
+    FlatArray<uint32_t> ranks;           // 番号 -> 辞書での位置
+    FlatArray<uint32_t> group_begin;     // グループ -> 先頭の番号
+    FlatArray<uint32_t> group_mask;      // グループ -> 文字の集合
+    FlatArray<uint32_t> list_begin;      // 文字 -> list_groups上の開始位置
+    FlatArray<uint32_t> list_groups;     // 転置リストを連結したもの
+};
+
+using ScoreIndex = BasicScoreIndex<EnglishAlphabet>;
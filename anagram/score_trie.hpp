@@ -0,0 +1,291 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include "letters.hpp"
+#include "index_file.hpp"
+#include "stats.hpp"
+
+// 文字の出現回数をキーにしたトライ木で、最もスコアの高い単語を分枝限定法で探す。
+// 深さdの辺は文字 Alphabet::ORDER[d] の出現回数を表し、スコアの高い(=珍しい)文字から並べる。
+// 各ノードには部分木の中で最も良い単語(スコア最大、同点なら辞書で先)を持たせておき、
+// それまでに見つかった単語を超えられない部分木には入らない。
+// 文字とスコアは |Alphabet|(letters.hpp)で決まり、木の深さもアルファベットの文字数になる。
+template <class Alphabet>
+class BasicScoreTrie
+{
+public:
+    // 辞書の単語から木を作る
+    void build(const std::vector<std::string> &words)
+    {
+        // アルファベットにない文字を含む単語は作れないので入れない
+        // (count_letters()はそういう文字を無視するので、入れると別の単語として見つかってしまう)
+        std::vector<LetterCounts> word_counts(words.size());
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < words.size(); ++i)
+        {
+            if (!is_valid_word<Alphabet>(words[i]))
+                continue;
+            count_letters<Alphabet>(words[i], word_counts[i]);
+            order.push_back(i);
+        }
+        int n = order.size();
+
+        // キー(Alphabet::ORDER順の出現回数)の順、同じキーなら辞書順に並べる
+        std::sort(order.begin(), order.end(), [&](uint32_t l, uint32_t r)
+                  {
+                      for (int d = 0; d < DEPTH; ++d)
+                      {
+                          int c = Alphabet::ORDER[d];
+                          if (word_counts[l][c] != word_counts[r][c])
+                              return word_counts[l][c] < word_counts[r][c];
+                      }
+                      return l < r;
+                  });
+
+        std::vector<char> new_words_arena;
+        std::vector<uint32_t> new_offsets(1, 0);
+        std::vector<LetterCounts> sorted_counts;
+        for (uint32_t i : order)
+        {
+            new_words_arena.insert(new_words_arena.end(), words[i].begin(), words[i].end());
+            new_offsets.push_back(new_words_arena.size());
+            sorted_counts.push_back(word_counts[i]);
+        }
+
+        std::vector<Node> new_nodes(1, Node{0, 0, 0, 0, 0, 0});
+        if (n > 0)
+            build_node(new_nodes, 0, 0, 0, n, sorted_counts, order);
+
+        words_arena.assign(std::move(new_words_arena));
+        offsets.assign(std::move(new_offsets));
+        ranks.assign(std::move(order));
+        nodes.assign(std::move(new_nodes));
+    }
+
+    // 索引ファイルに書き出す
+    bool save(const std::string &filepath) const
+    {
+        IndexWriter writer(filepath, IndexKind::SCORE_TRIE, Alphabet::ID);
+        writer.write(words_arena);
+        writer.write(offsets);
+        writer.write(ranks);
+        writer.write(nodes);
+        return writer.good();
+    }
+
+    // mmapした索引ファイル |file| から読む。|file| はこの索引より長く生きていること。
+    bool load(const MappedFile &file)
+    {
+        IndexReader reader;
+        return reader.open(file, IndexKind::SCORE_TRIE, Alphabet::ID) &&
+               reader.read(words_arena) && reader.read(offsets) && reader.read(ranks) && reader.read(nodes) &&
+               !nodes.empty() && offsets.size() == ranks.size() + 1;
+    }
+
+    // |rack| の文字で作れる最もスコアの高い単語の番号を返す。作れる単語がなければ -1。
+    // 同点の単語が複数あるときは辞書で先に出てくるものを返す。
+    // |rack| の空白牌(BLANK)は足りない文字の代わりに使え、その文字は0点になる。
+    int find_best(std::string_view rack) const
+    {
+        return find_best(rack, [](uint32_t)
+                         { return false; });
+    }
+
+    // find_best(rack)と同じだが、|skip|(番号) がtrueになる単語(削除された単語など)は使わない
+    template <class Skip>
+    int find_best(std::string_view rack, Skip skip) const
+    {
+        LetterCounts rack_counts;
+        uint32_t rack_mask = count_letters<Alphabet>(rack, rack_counts);
+        int blanks = count_blanks(rack);
+        // rest[d]: 深さd以降の文字でラックから得られるスコアの合計(空白牌は0点なので含めない)
+        std::array<int, DEPTH + 1> rest;
+        rest[DEPTH] = 0;
+        for (int d = DEPTH - 1; d >= 0; --d)
+            rest[d] = rest[d + 1] + rack_counts[Alphabet::ORDER[d]] * Alphabet::SCORE[Alphabet::ORDER[d]];
+        Best best;
+        if (!nodes.empty() && nodes[0].num_children > 0)
+            search(0, 0, 0, blanks, rack_counts, rack_mask, rest, skip, best);
+        return best.entry;
+    }
+
+    // 単語 |str| の番号。なければ -1。
+    int find_word(std::string_view str) const
+    {
+        LetterCounts counts;
+        count_letters<Alphabet>(str, counts);
+        // キーをたどって葉まで降りる
+        uint32_t v = 0;
+        for (int depth = 0; depth < DEPTH; ++depth)
+        {
+            const Node &node = nodes[v];
+            uint32_t child = node.first_child, end = node.first_child + node.num_children;
+            while (child < end && nodes[child].count != counts[Alphabet::ORDER[depth]])
+                ++child;
+            if (child == end)
+                return -1;
+            v = child;
+        }
+        for (uint32_t e = nodes[v].first_child; e < nodes[v].first_child + nodes[v].num_children; ++e)
+        {
+            if (word(e) == str)
+                return e;
+        }
+        return -1;
+    }
+
+    // 番号 |e| の単語の辞書での位置
+    uint32_t rank(uint32_t e) const
+    {
+        return ranks[e];
+    }
+
+    // 番号 |e| の単語
+    std::string_view word(uint32_t e) const
+    {
+        return std::string_view(words_arena.data() + offsets[e], offsets[e + 1] - offsets[e]);
+    }
+
+    size_t size() const
+    {
+        return ranks.size();
+    }
+
+private:
+    static constexpr int DEPTH = Alphabet::SIZE; // 葉の深さ
+
+    // 木のノード。深さDEPTHのノード(葉)では、first_child/num_childrenが同じキーを持つ単語の範囲になる。
+    struct Node
+    {
+        uint32_t first_child;
+        uint32_t num_children;
+        uint32_t best_rank;  // 部分木で最も良い単語の辞書での位置
+        uint32_t required;   // 部分木のすべての単語に含まれる文字の集合
+        uint16_t max_score;  // 部分木で最も高いスコア
+        uint8_t count;       // 親からこのノードへの辺が表す出現回数
+    };
+
+    // 探索中に見つかった最も良い単語
+    struct Best
+    {
+        int entry = -1;
+        int score = 0;
+        uint32_t rank = 0;
+    };
+
+    // sorted_counts[lo, hi) を子孫に持つノード |v| (深さ |depth|) を作る
+    // |ranks|: 番号 -> 辞書での位置
+    static void build_node(std::vector<Node> &nodes, uint32_t v, int depth, uint32_t lo, uint32_t hi,
+                           const std::vector<LetterCounts> &sorted_counts, const std::vector<uint32_t> &ranks)
+    {
+        if (depth == DEPTH)
+        {
+            nodes[v].first_child = lo;
+            nodes[v].num_children = hi - lo;
+            nodes[v].max_score = get_score<Alphabet>(sorted_counts[lo]);
+            nodes[v].best_rank = ranks[lo];
+            nodes[v].required = get_mask<Alphabet>(sorted_counts[lo]);
+            return;
+        }
+
+        int c = Alphabet::ORDER[depth];
+        // 子ノードは連続した位置にまとめて確保する
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        for (uint32_t i = lo; i < hi;)
+        {
+            uint32_t j = i + 1;
+            while (j < hi && sorted_counts[j][c] == sorted_counts[i][c])
+                ++j;
+            ranges.push_back(std::make_pair(i, j));
+            i = j;
+        }
+        uint32_t first = nodes.size();
+        nodes[v].first_child = first;
+        nodes[v].num_children = ranges.size();
+        for (auto range : ranges)
+            nodes.push_back(Node{0, 0, 0, ~0u, 0, sorted_counts[range.first][c]});
+
+        nodes[v].max_score = 0;
+        nodes[v].required = ~0u;
+        for (uint32_t k = 0; k < ranges.size(); ++k)
+        {
+            build_node(nodes, first + k, depth + 1, ranges[k].first, ranges[k].second, sorted_counts, ranks);
+            const Node &child = nodes[first + k];
+            nodes[v].required &= child.required;
+            if (child.max_score > nodes[v].max_score ||
+                (child.max_score == nodes[v].max_score && child.best_rank < nodes[v].best_rank))
+            {
+                nodes[v].max_score = child.max_score;
+                nodes[v].best_rank = child.best_rank;
+            }
+        }
+    }
+
+    // ノード |v| の部分木が今の最良の単語を超えうるか
+    bool can_improve(const Node &v, const Best &best) const
+    {
+        return best.entry == -1 || v.max_score > best.score || (v.max_score == best.score && v.best_rank < best.rank);
+    }
+
+    // |path_score|: 根から |v| までの辺で使った文字のスコア(空白牌で補った文字は0点)
+    // |blanks|: まだ使っていない空白牌の数
+    // 空白牌があると実際のスコアはノードのmax_score以下になるが、max_scoreはそのまま上限として使える。
+    template <class Skip>
+    void search(uint32_t v, int depth, int path_score, int blanks, const LetterCounts &rack, uint32_t rack_mask,
+                const std::array<int, DEPTH + 1> &rest, Skip &skip, Best &best) const
+    {
+        const Node &node = nodes[v];
+        COUNT_EXAMINED(1);
+        if (!can_improve(node, best))
+            return;
+        // 部分木のどの単語にも必要な(まだ辺で決まっていない)文字のうち、ラックにないものが空白牌より多い
+        uint32_t lacking = node.required & ~rack_mask & ~Alphabet::ORDER_MASK[depth];
+        if (lacking && __builtin_popcount(lacking) > blanks)
+            return;
+        // 残りのラックをすべて使えたとしても今の最良に届かない
+        if (best.entry != -1 && path_score + rest[depth] < best.score)
+            return;
+        if (depth == DEPTH)
+        {
+            // 葉の単語はすべて同じキー(= 同じスコア)で、辞書順に並んでいる
+            for (uint32_t e = node.first_child; e < node.first_child + node.num_children; ++e)
+            {
+                if (skip(e))
+                    continue;
+                if (best.entry == -1 || path_score > best.score || (path_score == best.score && ranks[e] < best.rank))
+                {
+                    best.entry = e;
+                    best.score = path_score;
+                    best.rank = ranks[e];
+                }
+                break;
+            }
+            return;
+        }
+
+        // 子は出現回数の昇順に並んでいるので、ラック(と空白牌)に収まる範囲を出現回数の多い方から見る
+        int c = Alphabet::ORDER[depth];
+        uint32_t end = node.first_child + node.num_children;
+        while (end > node.first_child && nodes[end - 1].count > rack[c] + blanks)
+            --end;
+        for (uint32_t child = end; child > node.first_child; --child)
+        {
+            int count = nodes[child - 1].count;
+            int used = count < rack[c] ? count : rack[c]; // ラックから使う数。残りは空白牌で補う。
+            search(child - 1, depth + 1, path_score + used * Alphabet::SCORE[c], blanks - (count - used),
+                   rack, rack_mask, rest, skip, best);
+        }
+    }
+
+    FlatArray<char> words_arena;   // 単語を連結したもの(キーの順)
+    FlatArray<uint32_t> offsets;   // 番号 -> arena上の開始位置
+    FlatArray<uint32_t> ranks;     // 番号 -> 辞書での位置
+    FlatArray<Node> nodes;         // nodes[0]が根
+};
+
+using ScoreTrie = BasicScoreTrie<EnglishAlphabet>;
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <cstdio>
+#include <cstring>
+#include <csignal>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+// 最近使われていないものから捨てる、大きさに上限のあるキャッシュ
+class LruCache
+{
+public:
+    explicit LruCache(size_t capacity)
+        : capacity(capacity)
+    {
+    }
+
+    // |key| の値を |value| に入れる。なければfalse。
+    bool get(const std::string &key, std::string &value)
+    {
+        auto found = table.find(key);
+        if (found == table.end())
+            return false;
+        // 使われたものを先頭に移す
+        entries.splice(entries.begin(), entries, found->second);
+        value = found->second->second;
+        return true;
+    }
+
+    void put(const std::string &key, const std::string &value)
+    {
+        if (capacity == 0)
+            return;
+        auto found = table.find(key);
+        if (found != table.end())
+        {
+            found->second->second = value;
+            entries.splice(entries.begin(), entries, found->second);
+            return;
+        }
+        if (entries.size() == capacity)
+        {
+            table.erase(entries.back().first);
+            entries.pop_back();
+        }
+        entries.emplace_front(key, value);
+        table[key] = entries.begin();
+    }
+
+    void erase(const std::string &key)
+    {
+        auto found = table.find(key);
+        if (found == table.end())
+            return;
+        entries.erase(found->second);
+        table.erase(found);
+    }
+
+    // |pred|(キー) がtrueになるものをすべて捨てる
+    template <class Pred>
+    void erase_if(Pred pred)
+    {
+        for (auto itr = entries.begin(); itr != entries.end();)
+        {
+            if (pred(itr->first))
+            {
+                table.erase(itr->first);
+                itr = entries.erase(itr);
+            }
+            else
+                ++itr;
+        }
+    }
+
+private:
+    size_t capacity;
+    std::list<std::pair<std::string, std::string>> entries; // 最近使われた順
+    std::unordered_map<std::string, std::list<std::pair<std::string, std::string>>::iterator> table;
+};
+
+// サーバーへのコマンド1行を分解したもの。
+//   query <rack>   ラックの答えを返す(コマンド名を省いて <rack> だけでもよい)
+//   add <word>     単語を辞書に追加する
+//   remove <word>  単語を辞書から削除する
+// コマンド名だけの行(引数が空)はコマンドとして扱い、serve_stream()がエラーを返す。
+// そのためコマンド名と同じ綴りのラックは query を付けて送る。空行はコマンドなし(名前が空)。
+struct Command
+{
+    std::string_view name;
+    std::string_view argument;
+};
+
+inline Command parse_command(std::string_view line)
+{
+    auto is_space = [](char c)
+    { return c == ' ' || c == '\t' || c == '\r'; };
+    size_t first = 0;
+    while (first < line.size() && is_space(line[first]))
+        ++first;
+    size_t last = line.size();
+    while (last > first && is_space(line[last - 1]))
+        --last;
+    line = line.substr(first, last - first);
+
+    Command command;
+    if (line.empty())
+        return command;
+    size_t space = line.find(' ');
+    if (space == std::string_view::npos)
+    {
+        bool is_name = line == "query" || line == "add" || line == "remove";
+        command.name = is_name ? line : "query";
+        command.argument = is_name ? std::string_view() : line;
+        return command;
+    }
+    command.name = line.substr(0, space);
+    command.argument = line.substr(space + 1);
+    while (!command.argument.empty() && is_space(command.argument.front()))
+        command.argument.remove_prefix(1);
+    return command;
+}
+
+// |in_fd| から1行ずつコマンドを読み、|handle|(コマンド, 出力) の結果を1行ずつ |out_fd| に返す。
+// 空行は読み飛ばし、引数のないコマンドには |handle| を呼ばずにエラーの行を返す。
+// 入力が途切れたら、改行で終わっていない最後の行も処理してから戻る。
+template <class Handler>
+void serve_stream(int in_fd, int out_fd, Handler &handle)
+{
+    std::string buffer, response;
+    char block[1 << 12];
+    auto serve_line = [&](std::string_view line)
+    {
+        Command command = parse_command(line);
+        if (command.name.empty())
+            return;
+        if (command.argument.empty())
+            response += "ERROR missing argument";
+        else
+            handle(command, response);
+        response += '\n';
+    };
+    while (true)
+    {
+#ifdef _WIN32
+        int n = _read(in_fd, block, sizeof(block));
+#else
+        ssize_t n = read(in_fd, block, sizeof(block));
+#endif
+        bool at_end = n <= 0;
+        if (!at_end)
+            buffer.append(block, n);
+
+        // 届いた分の行をすべて処理してからまとめて返す
+        size_t line_begin = 0, newline;
+        response.clear();
+        while ((newline = buffer.find('\n', line_begin)) != std::string::npos)
+        {
+            serve_line(std::string_view(buffer).substr(line_begin, newline - line_begin));
+            line_begin = newline + 1;
+        }
+        if (at_end && line_begin < buffer.size())
+            serve_line(std::string_view(buffer).substr(line_begin));
+        buffer.erase(0, line_begin);
+
+        for (size_t written = 0; written < response.size();)
+        {
+#ifdef _WIN32
+            int w = _write(out_fd, response.data() + written, response.size() - written);
+#else
+            ssize_t w = write(out_fd, response.data() + written, response.size() - written);
+#endif
+            if (w <= 0)
+                return;
+            written += w;
+        }
+        if (at_end)
+            return;
+    }
+}
+
+// Unixドメインソケット |path| で待ち受け、接続してきたクライアントを1つずつserve_stream()で処理し続ける。
+// 待ち受けを始められなければfalse。
+template <class Handler>
+bool serve_unix_socket(const std::string &path, Handler &handle)
+{
+#ifdef _WIN32
+    (void)path;
+    (void)handle;
+    return false;
+#else
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    std::strcpy(address.sun_path, path.c_str());
+
+    // 途中で切断したクライアントに書き込んでも落ちないようにする
+    std::signal(SIGPIPE, SIG_IGN);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        return false;
+    unlink(path.c_str()); // 前回のソケットファイルが残っていれば消す
+    if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 16) != 0)
+    {
+        close(listener);
+        return false;
+    }
+    while (true)
+    {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0)
+            continue;
+        serve_stream(client, client, handle);
+        close(client);
+    }
+#endif
+}
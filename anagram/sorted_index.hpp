@@ -0,0 +1,167 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include <utility>
+#include "index_file.hpp"
+#include "stats.hpp"
+
+// ソート後の文字列(シグネチャ)をキーにした、オープンアドレス法のハッシュ索引。
+// 単語とシグネチャはそれぞれ1本の連続した文字列(arena)に詰めて持つ。
+// 単語idはシグネチャ順に振り直してあるので、同じシグネチャの単語は連続したidの範囲になる。
+class SortedIndex
+{
+public:
+    // 辞書の単語から索引を作る
+    void build(const std::vector<std::string> &words)
+    {
+        int n = words.size();
+
+        // シグネチャ順(同じシグネチャなら辞書順)に並べ替える
+        std::vector<std::string> sigs(n);
+        for (int i = 0; i < n; ++i)
+        {
+            sigs[i] = words[i];
+            std::sort(sigs[i].begin(), sigs[i].end());
+        }
+        std::vector<uint32_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t l, uint32_t r)
+                         { return sigs[l] < sigs[r]; });
+
+        // arenaに詰める
+        std::vector<char> new_words_arena, new_sigs_arena;
+        std::vector<uint32_t> new_offsets(1, 0);
+        for (uint32_t i : order)
+        {
+            new_words_arena.insert(new_words_arena.end(), words[i].begin(), words[i].end());
+            new_sigs_arena.insert(new_sigs_arena.end(), sigs[i].begin(), sigs[i].end());
+            new_offsets.push_back(new_words_arena.size());
+        }
+        words_arena.assign(std::move(new_words_arena));
+        sigs_arena.assign(std::move(new_sigs_arena));
+        offsets.assign(std::move(new_offsets));
+
+        // シグネチャごとの範囲を数えてテーブルの大きさを決める(負荷率1/2以下)
+        int num_of_keys = 0;
+        for (int id = 0; id < n; ++id)
+        {
+            if (id == 0 || signature(id) != signature(id - 1))
+                ++num_of_keys;
+        }
+        size_t capacity = 16;
+        while (capacity < 2 * (size_t)num_of_keys)
+            capacity *= 2;
+        std::vector<Slot> new_table(capacity, Slot{0, 0, 0});
+        mask = capacity - 1;
+
+        for (int first = 0; first < n;)
+        {
+            int last = first + 1;
+            while (last < n && signature(last) == signature(first))
+                ++last;
+
+            uint64_t h = hash(signature(first));
+            size_t pos = h & mask;
+            while (new_table[pos].last != 0)
+                pos = (pos + 1) & mask;
+            new_table[pos] = Slot{(uint32_t)(h >> 32), (uint32_t)first, (uint32_t)last};
+
+            first = last;
+        }
+        table.assign(std::move(new_table));
+    }
+
+    // 索引ファイルに書き出す
+    bool save(const std::string &filepath) const
+    {
+        IndexWriter writer(filepath, IndexKind::SORTED_INDEX);
+        writer.write(words_arena);
+        writer.write(sigs_arena);
+        writer.write(offsets);
+        writer.write(table);
+        return writer.good();
+    }
+
+    // mmapした索引ファイル |file| から読む。|file| はこの索引より長く生きていること。
+    bool load(const MappedFile &file)
+    {
+        IndexReader reader;
+        if (!reader.open(file, IndexKind::SORTED_INDEX) ||
+            !reader.read(words_arena) || !reader.read(sigs_arena) || !reader.read(offsets) || !reader.read(table))
+            return false;
+        // テーブルの大きさは2のべき乗のはず
+        if (table.empty() || (table.size() & (table.size() - 1)) != 0 || offsets.empty() ||
+            offsets[offsets.size() - 1] != words_arena.size() || sigs_arena.size() != words_arena.size())
+            return false;
+        mask = table.size() - 1;
+        return true;
+    }
+
+    // |sig|: ソート済みの文字列。
+    // 同じシグネチャを持つ単語idの範囲[first, last)を返す。見つからなければfirst == last。
+    std::pair<uint32_t, uint32_t> find(std::string_view sig) const
+    {
+        if (table.empty())
+            return std::make_pair(0, 0);
+        uint64_t h = hash(sig);
+        uint32_t tag = h >> 32;
+        for (size_t pos = h & mask; table[pos].last != 0; pos = (pos + 1) & mask)
+        {
+            const Slot &slot = table[pos];
+            COUNT_EXAMINED(1);
+            if (slot.tag == tag && signature(slot.first) == sig)
+                return std::make_pair(slot.first, slot.last);
+        }
+        return std::make_pair(0, 0);
+    }
+
+    // 単語id |id| の単語
+    std::string_view word(uint32_t id) const
+    {
+        return std::string_view(words_arena.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    // 単語id |id| のシグネチャ
+    std::string_view signature(uint32_t id) const
+    {
+        return std::string_view(sigs_arena.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    size_t size() const
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+private:
+    // ハッシュテーブルの1要素。last == 0 なら空き。
+    struct Slot
+    {
+        uint32_t tag;   // ハッシュ値の上位32bit
+        uint32_t first; // 単語idの範囲
+        uint32_t last;
+    };
+
+    // FNV-1a
+    static uint64_t hash(std::string_view s)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        for (char c : s)
+        {
+            h ^= (unsigned char)c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    FlatArray<char> words_arena;   // 単語を連結したもの
+    FlatArray<char> sigs_arena;    // シグネチャを連結したもの(wordsと同じ位置に並ぶ)
+    FlatArray<uint32_t> offsets;   // 単語id -> arena上の開始位置
+    FlatArray<Slot> table;
+    size_t mask = 0;
+};
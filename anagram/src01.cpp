@@ -1,49 +1,172 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <fstream>
-#include <map>
+#include <vector>
 #include <algorithm>
+#include "sorted_index.hpp"
+#include "batch.hpp"
+#include "mapped_file.hpp"
+#include "query_io.hpp"
+#include "live_dictionary.hpp"
+#include "near_anagram.hpp"
+#include "server.hpp"
 using namespace std;
 
-multimap<string, string> dict;    // ソート後の辞書
+SortedIndex dict;    // ソート後の辞書
+bool near_mode = false;    // 1文字違いのアナグラムも返す(--near)
 
-void solve(string str){
-    sort(str.begin(), str.end());
-    // 二分探索
-    auto itr1 = dict.lower_bound(str);
-    auto itr2 = dict.upper_bound(str);
-    if (itr1 == itr2) cout << "NOT FOUND" << endl;
-    else {
-        for(auto itr = itr1; itr != itr2; ++itr){
-            cout << (*itr).second << endl;
-        }
+// |str| のアナグラム(near_modeなら続けて1文字違いのアナグラムも)をすべて改行区切りで |out| に追記する
+void solve(string_view str, string &out){
+    static thread_local string sig;    // クエリごとに確保しなおさないよう使い回す
+    sig.assign(str);
+    sort(sig.begin(), sig.end());
+    // ハッシュ表で同じシグネチャの単語の範囲を引く
+    auto range = dict.find(sig);
+    bool found = range.first != range.second;
+    for(uint32_t id = range.first; id != range.second; ++id){
+        out += dict.word(id);
+        out += '\n';
     }
+    if (near_mode) {
+        // 続けて、1文字の削除・挿入・置換で作れるシグネチャを1つずつ引く
+        for_each_near_signature(sig, [&](string_view near) {
+            auto near_range = dict.find(near);
+            for(uint32_t id = near_range.first; id != near_range.second; ++id){
+                out += dict.word(id);
+                out += '\n';
+                found = true;
+            }
+        });
+    }
+    if (!found) out += "NOT FOUND\n";
 }
 
-int main(){
+// 常駐して1行ずつコマンドを処理する(server.hppのCommandを参照)。
+// 答えはシグネチャをキーにLRUキャッシュし、単語の追加・削除で変わるシグネチャだけ捨てる。
+// |socket_path| が空なら標準入出力、そうでなければUnixドメインソケットでやりとりする。
+int run_server(const string &socket_path, size_t cache_size){
+    LiveAnagramDictionary live(dict);
+    LruCache cache(cache_size);
 
-    string filepath = "input_data\\words.txt";   //辞書のファイルパス
-    
-    // ファイルを開く
-    ifstream ifs(filepath);
-    if(!ifs){
-        cout << "File not opened." << endl;
-        system("pause");
+    auto handle = [&](const Command &command, string &out) {
+        string sig = LiveAnagramDictionary::get_signature(command.argument);
+        if (command.name == "query") {
+            string answer;
+            if (!cache.get(sig, answer)) {
+                // サーバーでは1コマンド1行で返すので、アナグラムは空白区切りにする
+                for (string_view word: live.find(sig)) {
+                    if (!answer.empty()) answer += ' ';
+                    answer += word;
+                }
+                if (answer.empty()) answer = "NOT FOUND";
+                cache.put(sig, answer);
+            }
+            out += answer;
+        }
+        else if (command.name == "add" || command.name == "remove") {
+            if (!is_valid_word(command.argument)) {
+                out += "ERROR invalid word";
+                return;
+            }
+            if (command.name == "add") out += live.add(command.argument) ? "OK" : "EXISTS";
+            else out += live.remove(command.argument) ? "OK" : "NOT FOUND";
+            cache.erase(sig);
+        }
+        else out += "ERROR unknown command";
+    };
+
+    if (socket_path.empty()) {
+        serve_stream(0, 1, handle);
+        return 0;
+    }
+    if (!serve_unix_socket(socket_path, handle)) {
+        cout << "Failed to listen on " << socket_path << "." << endl;
         return 1;
     }
+    return 0;
+}
 
-    // 辞書を読みだす
-    string str;
-    while(getline(ifs, str)){
-        string newstr = str;
-        // ソートしてdictに挿入
-        sort(newstr.begin(), newstr.end());
-        dict.insert(make_pair(newstr, str));
+int main(int argc, char *argv[]){
+
+    // オプション
+    int num_of_threads = 1;
+    string index_path;         // 読み込む索引ファイル
+    string save_index_path;    // 索引を作って書き出すファイル
+    string input_path;         // クエリファイル(なければ標準入力)
+    bool server_mode = false;  // 常駐してコマンドを処理する
+    string socket_path;        // サーバーが待ち受けるUnixドメインソケット(なければ標準入出力)
+    size_t cache_size = 10000; // サーバーのキャッシュに持つ答えの数
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) num_of_threads = get_num_of_threads(stoi(arg.substr(10)));
+        else if (arg.rfind("--index=", 0) == 0) index_path = arg.substr(8);
+        else if (arg.rfind("--save-index=", 0) == 0) save_index_path = arg.substr(13);
+        else if (arg.rfind("--input=", 0) == 0) input_path = arg.substr(8);
+        else if (arg == "--server") server_mode = true;
+        else if (arg.rfind("--socket=", 0) == 0) {
+            socket_path = arg.substr(9);
+            server_mode = true;
+        }
+        else if (arg.rfind("--cache=", 0) == 0) cache_size = stoul(arg.substr(8));
+        else if (arg == "--near") near_mode = true;
+        else {
+            cerr << "Usage: " << argv[0] << " [--threads=N] [--index=FILE | --save-index=FILE] [--input=FILE] [--near]" << endl;
+            cerr << "       " << argv[0] << " --server [--socket=PATH] [--cache=N] [--index=FILE]" << endl;
+            return 1;
+        }
     }
 
+    MappedFile index_file;    // 索引ファイル(dictより長く生きる必要がある)
+    if (!index_path.empty()) {
+        // 作成済みの索引をmmapして使う
+        if (!index_file.open(index_path)) {
+            cout << "Index file not opened." << endl;
+            return 1;
+        }
+        if (!dict.load(index_file)) {
+            cout << "Index file is broken or built by another version." << endl;
+            return 1;
+        }
+    }
+    else {
+        string filepath = "input_data\\words.txt";   //辞書のファイルパス
+
+        // ファイルを開く
+        ifstream ifs(filepath);
+        if(!ifs){
+            cout << "File not opened." << endl;
+            system("pause");
+            return 1;
+        }
+
+        // 辞書を読みだす
+        vector<string> words;
+        string str;
+        while(getline(ifs, str)) words.push_back(str);
+        // ソートして索引を作る
+        dict.build(words);
+    }
+
+    // 索引を書き出すだけ
+    if (!save_index_path.empty()) {
+        if (!dict.save(save_index_path)) {
+            cout << "Failed to write the index file." << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (server_mode) return run_server(socket_path, cache_size);
+
     // main
-    string tmp;
-    while(cin >> tmp) solve(tmp);
+    QueryReader reader;
+    if (input_path.empty()) reader.open_stdin();
+    else if (!reader.open(input_path)) {
+        cout << "Input file not opened." << endl;
+        return 1;
+    }
+    answer_queries(reader, num_of_threads, solve);
 
     return 0;
 }
@@ -1,76 +1,225 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <fstream>
-#include <map>
-#include <array>
+#include <vector>
 #include <algorithm>
+#include "score_index.hpp"
+#include "score_trie.hpp"
+#include "batch.hpp"
+#include "mapped_file.hpp"
+#include "query_io.hpp"
+#include "live_dictionary.hpp"
+#include "server.hpp"
 using namespace std;
 
-// arrayのsum(=score)降順に辞書をソート
-auto is_former = [](array<int,26> l, array<int,26> r){
-    int lsum=0, rsum=0;
-    for(int i=0; i<26; ++i){
-        lsum += l[i];
-        rsum += r[i];
-    }
-    return lsum > rsum;
-};
+// 辞書(アルファベットごと。使うのは --scores で選んだものだけ)
+template <class Alphabet> BasicScoreTrie<Alphabet> dict;           // 出現回数のトライ木(既定)
+template <class Alphabet> BasicScoreIndex<Alphabet> index_dict;    // スコア順の索引(--engine=index のとき)
+bool use_index = false;
+bool list_mode = false;   // 上位k個またはしきい値以上をすべて返す(--top, --min-score)
+size_t top_k = 0;         // 0なら個数の制限なし
+int min_score = 0;
 
-// 辞書
-multimap<array<int, 26>, string, decltype(is_former)> dict(is_former);    // ソート後の辞書
+// |str| の文字で作れる最もスコアの高い単語(list_modeなら単語のリスト)を |out| に追記する
+template <class Alphabet>
+void solve(string_view str, string &out){
 
-//各アルファベットのスコア
-const int SCORE[26] = {
-    1,3,2,2,1,3,3,1,1,4,4,2,2,1,1,3,4,1,1,1,2,3,3,4,3,4
-};
-
-void solve(string str){
+    // アルファベットにない文字を含むラックは、その文字を黙って無視せずにエラーにする
+    if (!is_valid_rack<Alphabet>(str)) {
+        out += "ERROR invalid rack\n";
+        return;
+    }
 
-    array<int,26> arr = {0};    // 出現頻度
-    for(char c: str) arr[c-'a'] += SCORE[c-'a'];
+    if (list_mode) {
+        // 複数の答えを空白区切りで1行に並べる
+        vector<uint32_t> found = index_dict<Alphabet>.find_top(str, top_k, min_score);
+        if (found.empty()) out += "NOT FOUND";
+        for (size_t i = 0; i < found.size(); ++i) {
+            if (i > 0) out += ' ';
+            out += index_dict<Alphabet>.word(found[i]);
+        }
+        out += '\n';
+        return;
+    }
 
     // スコアが大きい単語から調べる
-    for(auto word: dict){
-        bool flg = true;
-        for(int i = 0; i < 26; ++i){
-            if (arr[i] < word.first[i]){
-                flg = false;
-                break;
+    int best = use_index ? index_dict<Alphabet>.find_best(str) : dict<Alphabet>.find_best(str);
+    if (best == -1) out += "NOT FOUND";
+    else out += use_index ? index_dict<Alphabet>.word(best) : dict<Alphabet>.word(best);
+    out += '\n';
+}
+
+// 常駐して1行ずつコマンドを処理する(server.hppのCommandを参照)。トライ木を使う。
+// 答えはソートしたラックをキーにLRUキャッシュし、単語の追加・削除で答えが変わりうるラックだけ捨てる。
+// |socket_path| が空なら標準入出力、そうでなければUnixドメインソケットでやりとりする。
+template <class Alphabet>
+int run_server(const string &socket_path, size_t cache_size){
+    LiveScoreDictionary<Alphabet> live(dict<Alphabet>);
+    LruCache cache(cache_size);
+
+    auto handle = [&](const Command &command, string &out) {
+        if (command.name == "query") {
+            if (!is_valid_rack<Alphabet>(command.argument)) {
+                out += "ERROR invalid rack";
+                return;
             }
+            string key(command.argument);
+            sort(key.begin(), key.end());
+            string answer;
+            if (!cache.get(key, answer)) {
+                answer = live.find_best(command.argument);
+                if (answer.empty()) answer = "NOT FOUND";
+                cache.put(key, answer);
+            }
+            out += answer;
         }
-        if (flg) {
-            cout << word.second << endl;
-            return;
+        else if (command.name == "add" || command.name == "remove") {
+            if (!is_valid_word<Alphabet>(command.argument)) {
+                out += "ERROR invalid word";
+                return;
+            }
+            if (command.name == "add") out += live.add(command.argument) ? "OK" : "EXISTS";
+            else out += live.remove(command.argument) ? "OK" : "NOT FOUND";
+            // その単語を作れるラックの答えだけが変わりうる
+            LetterCounts word_counts;
+            count_letters<Alphabet>(command.argument, word_counts);
+            cache.erase_if([&](const string &key) {
+                LetterCounts rack_counts;
+                count_letters<Alphabet>(key, rack_counts);
+                return count_missing<Alphabet>(word_counts, rack_counts) <= count_blanks(key);
+            });
         }
+        else out += "ERROR unknown command";
+    };
+
+    if (socket_path.empty()) {
+        serve_stream(0, 1, handle);
+        return 0;
+    }
+    if (!serve_unix_socket(socket_path, handle)) {
+        cout << "Failed to listen on " << socket_path << "." << endl;
+        return 1;
     }
-    cout << "NOT FOUND" << endl;
-    return;
+    return 0;
 }
 
-int main(){
+// コマンドラインで指定するもの(--scores以外)
+struct Options {
+    int num_of_threads = 1;
+    string index_path;         // 読み込む索引ファイル
+    string save_index_path;    // 索引を作って書き出すファイル
+    string input_path;         // クエリファイル(なければ標準入力)
+    bool server_mode = false;  // 常駐してコマンドを処理する
+    string socket_path;        // サーバーが待ち受けるUnixドメインソケット(なければ標準入出力)
+    size_t cache_size = 10000; // サーバーのキャッシュに持つ答えの数
+};
 
-    string filepath = "input_data\\words.txt";   //辞書のファイルパス
-    
-    // 辞書ファイルを開く
-    ifstream ifs(filepath);
-    if(!ifs){
-        cout << "File not opened." << endl;
-        system("pause");
-        return 1;
+// アルファベット |Alphabet| の辞書を用意してクエリに答える
+template <class Alphabet>
+int run(const Options &options){
+
+    MappedFile index_file;    // 索引ファイル(dictより長く生きる必要がある)
+    if (!options.index_path.empty()) {
+        // 作成済みの索引をmmapして使う
+        if (!index_file.open(options.index_path)) {
+            cout << "Index file not opened." << endl;
+            return 1;
+        }
+        if (!(use_index ? index_dict<Alphabet>.load(index_file) : dict<Alphabet>.load(index_file))) {
+            cout << "Index file is broken or built by another version, engine or scores." << endl;
+            return 1;
+        }
+    }
+    else {
+        string filepath = "input_data\\words.txt";   //辞書のファイルパス
+
+        // 辞書ファイルを開く
+        ifstream ifs(filepath);
+        if(!ifs){
+            cout << "File not opened." << endl;
+            system("pause");
+            return 1;
+        }
+
+        // 辞書を読みだす
+        vector<string> words;
+        string str;
+        while(getline(ifs, str)) words.push_back(str);
+        // 出現頻度とスコアを数えて索引を作る
+        if (use_index) index_dict<Alphabet>.build(words);
+        else dict<Alphabet>.build(words);
     }
 
-    // 辞書を読みだす
-    string str;
-    while(getline(ifs, str)){
-        array<int,26> arr = {0};
-        // 出現頻度をアルファベットのスコアで重みづけ
-        for(char c: str) arr[c-'a'] += SCORE[c-'a'];
-        dict.insert(make_pair(arr, str));
+    // 索引を書き出すだけ
+    if (!options.save_index_path.empty()) {
+        if (!(use_index ? index_dict<Alphabet>.save(options.save_index_path) : dict<Alphabet>.save(options.save_index_path))) {
+            cout << "Failed to write the index file." << endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (options.server_mode) {
+        if (use_index) {
+            cerr << "The server uses the trie engine." << endl;
+            return 1;
+        }
+        return run_server<Alphabet>(options.socket_path, options.cache_size);
     }
 
     // main
-    string tmp;
-    while(cin >> tmp) solve(tmp);
+    QueryReader reader;
+    if (options.input_path.empty()) reader.open_stdin();
+    else if (!reader.open(options.input_path)) {
+        cout << "Input file not opened." << endl;
+        return 1;
+    }
+    answer_queries(reader, options.num_of_threads, solve<Alphabet>);
 
     return 0;
 }
+
+int main(int argc, char *argv[]){
+
+    // オプション
+    Options options;
+    string scores = "english"; // スコア表(アルファベット)
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--engine=index") use_index = true;
+        else if (arg == "--engine=trie") use_index = false;
+        else if (arg.rfind("--threads=", 0) == 0) options.num_of_threads = get_num_of_threads(stoi(arg.substr(10)));
+        else if (arg.rfind("--index=", 0) == 0) options.index_path = arg.substr(8);
+        else if (arg.rfind("--save-index=", 0) == 0) options.save_index_path = arg.substr(13);
+        else if (arg.rfind("--input=", 0) == 0) options.input_path = arg.substr(8);
+        else if (arg == "--server") options.server_mode = true;
+        else if (arg.rfind("--socket=", 0) == 0) {
+            options.socket_path = arg.substr(9);
+            options.server_mode = true;
+        }
+        else if (arg.rfind("--scores=", 0) == 0) scores = arg.substr(9);
+        else if (arg.rfind("--cache=", 0) == 0) options.cache_size = stoul(arg.substr(8));
+        else if (arg.rfind("--top=", 0) == 0) {
+            top_k = stoul(arg.substr(6));
+            list_mode = use_index = true;
+        }
+        else if (arg.rfind("--min-score=", 0) == 0) {
+            min_score = stoi(arg.substr(12));
+            list_mode = use_index = true;
+        }
+        else {
+            cerr << "Usage: " << argv[0] << " [--engine=trie|index] [--threads=N] [--index=FILE | --save-index=FILE] [--input=FILE] [--top=K] [--min-score=S] [--scores=english|unit|italian]" << endl;
+            cerr << "       " << argv[0] << " --server [--socket=PATH] [--cache=N] [--index=FILE] [--scores=english|unit|italian]" << endl;
+            cerr << "--top and --min-score use the index engine. The server uses the trie engine." << endl;
+            return 1;
+        }
+    }
+
+    // アルファベットごとに特殊化したエンジンを1度だけ選ぶ
+    if (scores == "english") return run<EnglishAlphabet>(options);
+    if (scores == "unit") return run<UnitAlphabet>(options);
+    if (scores == "italian") return run<ItalianAlphabet>(options);
+    cerr << "Unknown scores: " << scores << endl;
+    return 1;
+}
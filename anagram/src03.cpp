@@ -0,0 +1,74 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <vector>
+#include "sorted_index.hpp"
+#include "score_index.hpp"
+#include "phrase_search.hpp"
+#include "batch.hpp"
+#include "query_io.hpp"
+using namespace std;
+
+// 辞書
+SortedIndex sorted_dict;    // ソート後の辞書(残りがちょうど1語になるかを引く)
+ScoreIndex score_dict;      // ラックで作れる単語を列挙する
+size_t limit = 100;         // 1クエリあたりに出力するフレーズの数の上限
+size_t min_length = 1;      // フレーズに使う単語の最短の長さ
+
+// |str| の文字をちょうど使い切るフレーズを1行ずつ |out| に追記する
+void solve(PhraseSearch &search, string_view str, string &out){
+    // アルファベットにない文字は黙って無視せずにエラーにする。フレーズの探索は空白牌に対応していないので空白牌も同じ。
+    if (!is_valid_rack(str) || str.find(BLANK) != string_view::npos) {
+        out += "ERROR invalid rack\n";
+        return;
+    }
+    if (search.find(str, limit, out) == 0) out += "NOT FOUND\n";
+}
+
+int main(int argc, char *argv[]){
+
+    // オプション
+    string input_path;         // クエリファイル(なければ標準入力)
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--limit=", 0) == 0) limit = stoul(arg.substr(8));
+        else if (arg.rfind("--min-length=", 0) == 0) min_length = stoul(arg.substr(13));
+        else if (arg.rfind("--input=", 0) == 0) input_path = arg.substr(8);
+        else {
+            cerr << "Usage: " << argv[0] << " [--limit=N] [--min-length=N] [--input=FILE]" << endl;
+            return 1;
+        }
+    }
+
+    string filepath = "input_data\\words.txt";   //辞書のファイルパス
+
+    // 辞書ファイルを開く
+    ifstream ifs(filepath);
+    if(!ifs){
+        cout << "File not opened." << endl;
+        system("pause");
+        return 1;
+    }
+
+    // 辞書を読みだす
+    vector<string> words;
+    string str;
+    while(getline(ifs, str)) words.push_back(str);
+    sorted_dict.build(words);
+    score_dict.build(words);
+
+    // main
+    QueryReader reader;
+    if (input_path.empty()) reader.open_stdin();
+    else if (!reader.open(input_path)) {
+        cout << "Input file not opened." << endl;
+        return 1;
+    }
+    // メモを共有するので1スレッドで解く
+    PhraseSearch search(sorted_dict, score_dict);
+    search.set_min_length(min_length);
+    answer_queries(reader, 1, [&](string_view query, string &out) { solve(search, query, out); });
+
+    return 0;
+}
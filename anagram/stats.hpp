@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// クエリごとの計測。ANAGRAM_STATS を定義してビルドしたとき(bench.cpp)だけ、
+// 各エンジンが調べた辞書の項目(ハッシュ表のスロット、単語、トライ木のノード)の数を数える。
+// 定義しなければ何もしないので、src01〜src03の速度には影響しない。
+#ifdef ANAGRAM_STATS
+inline thread_local uint64_t examined_entries = 0; // このスレッドでこれまでに調べた項目の数
+#define COUNT_EXAMINED(n) (examined_entries += (n))
+#else
+#define COUNT_EXAMINED(n) ((void)0)
+#endif
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include "utils.hpp"
+#include "kd_tree.hpp"
+
+// Distance oracles.
+// Every solver function takes one of the classes below as |distances|, and only uses
+//   distances.size()   : the number of cities
+//   distances(i, j)    : the distance between city i and city j
+// so the backends can be swapped without touching the solver.
+// distances(i, j) is always equal to distances(j, i), bit for bit.
+
+// Stores the lower triangle of the distance matrix as float.
+// N(N-1)/2 * 4 bytes: 128 MB for 8192 cities, a quarter of the N*N doubles.
+class PackedDistances
+{
+public:
+    explicit PackedDistances(const std::vector<City> &cities)
+        : num_of_cities(cities.size()), values((size_t)num_of_cities * (num_of_cities - 1) / 2)
+    {
+        for (int i = 0; i < num_of_cities; ++i)
+        {
+            float *row = values.data() + row_start(i);
+            for (int j = 0; j < i; ++j)
+            {
+                row[j] = std::sqrt(
+                    (cities[i].x - cities[j].x) * (cities[i].x - cities[j].x) + (cities[i].y - cities[j].y) * (cities[i].y - cities[j].y));
+            }
+        }
+    }
+
+    int size() const
+    {
+        return num_of_cities;
+    }
+
+    double operator()(int i, int j) const
+    {
+        if (i == j)
+            return 0.0;
+        if (i < j)
+            std::swap(i, j);
+        return values[row_start(i) + j];
+    }
+
+private:
+    // Index of distances(i, 0) in |values|.
+    static size_t row_start(int i)
+    {
+        return (size_t)i * (i - 1) / 2;
+    }
+
+    int num_of_cities;
+    std::vector<float> values;
+};
+
+// Stores nothing but the coordinates (as two separate arrays), and computes every distance on demand.
+// O(N) memory, so it works for any number of cities.
+class ComputedDistances
+{
+public:
+    explicit ComputedDistances(const std::vector<City> &cities)
+    {
+        for (const City &city : cities)
+        {
+            xs.push_back(city.x);
+            ys.push_back(city.y);
+        }
+    }
+
+    int size() const
+    {
+        return xs.size();
+    }
+
+    double operator()(int i, int j) const
+    {
+        double dx = xs[i] - xs[j];
+        double dy = ys[i] - ys[j];
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+private:
+    std::vector<double> xs;
+    std::vector<double> ys;
+};
+
+// Caches the distances from each city to its candidate neighbors, and computes the others on demand.
+// Local search mostly looks at short edges, so most lookups hit the cache. O(Nk) memory.
+// A lookup scans the k neighbors, though, so it is slower than ComputedDistances in practice (not the default).
+class NeighborCachedDistances
+{
+public:
+    NeighborCachedDistances(const std::vector<City> &cities, const NeighborLists &neighbor_lists)
+        : num_of_neighbors(neighbor_lists.k), neighbors(neighbor_lists.cities)
+    {
+        for (const City &city : cities)
+        {
+            xs.push_back(city.x);
+            ys.push_back(city.y);
+        }
+        cached.resize(neighbors.size());
+        for (int i = 0; i < size(); ++i)
+        {
+            for (int n = 0; n < num_of_neighbors; ++n)
+                cached[(size_t)i * num_of_neighbors + n] = compute(i, neighbors[(size_t)i * num_of_neighbors + n]);
+        }
+    }
+
+    int size() const
+    {
+        return xs.size();
+    }
+
+    double operator()(int i, int j) const
+    {
+        const int *row = &neighbors[(size_t)i * num_of_neighbors];
+        for (int n = 0; n < num_of_neighbors; ++n)
+        {
+            if (row[n] == j)
+                return cached[(size_t)i * num_of_neighbors + n];
+        }
+        return compute(i, j);
+    }
+
+private:
+    // Rounded to float like the cached values, so that distances(i, j) == distances(j, i)
+    // even when only one of them is in the cache.
+    float compute(int i, int j) const
+    {
+        double dx = xs[i] - xs[j];
+        double dy = ys[i] - ys[j];
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    int num_of_neighbors;
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<int> neighbors; // neighbors[i * k + n]: the n-th nearest city from city i
+    std::vector<float> cached;  // cached[i * k + n]: the distance to it
+};
+
+// Returns the score(total distance) of |tour|.
+template <class Distances>
+double get_score(const std::vector<int> &tour, const Distances &distances)
+{
+    double score = 0.0;
+    for (int i = 0; i < (int)tour.size(); ++i)
+    {
+        score += distances(tour[i], tour[(i + 1) % tour.size()]);
+    }
+    return score;
+}
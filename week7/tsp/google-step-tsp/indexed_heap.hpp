@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+// A binary min-heap of the cities keyed by a double, which can change the key of any city in O(log N).
+// Each city is in the heap at most once, and |positions| tells where it is.
+class IndexedHeap
+{
+public:
+    explicit IndexedHeap(const int &num_of_cities)
+        : keys(num_of_cities), positions(num_of_cities, -1)
+    {
+    }
+
+    bool empty() const
+    {
+        return heap.empty();
+    }
+
+    bool contains(const int &city) const
+    {
+        return positions[city] != -1;
+    }
+
+    // The city with the smallest key.
+    int top() const
+    {
+        return heap.front();
+    }
+
+    double key(const int &city) const
+    {
+        return keys[city];
+    }
+
+    // Inserts |city|, or changes its key if it is already in the heap.
+    void push(const int &city, const double &key)
+    {
+        if (!contains(city))
+        {
+            positions[city] = heap.size();
+            heap.push_back(city);
+            keys[city] = key;
+            sift_up(positions[city]);
+        }
+        else if (key < keys[city])
+        {
+            keys[city] = key;
+            sift_up(positions[city]);
+        }
+        else
+        {
+            keys[city] = key;
+            sift_down(positions[city]);
+        }
+    }
+
+    // Removes the city with the smallest key and returns it.
+    int pop()
+    {
+        int city = heap.front();
+        swap_at(0, heap.size() - 1);
+        heap.pop_back();
+        positions[city] = -1;
+        if (!heap.empty())
+        {
+            sift_down(0);
+        }
+        return city;
+    }
+
+private:
+    void sift_up(int index)
+    {
+        while (index > 0)
+        {
+            int parent = (index - 1) / 2;
+            if (keys[heap[parent]] <= keys[heap[index]])
+            {
+                break;
+            }
+            swap_at(parent, index);
+            index = parent;
+        }
+    }
+
+    void sift_down(int index)
+    {
+        while (true)
+        {
+            int smallest = index;
+            for (int child = 2 * index + 1; child <= 2 * index + 2 && child < (int)heap.size(); ++child)
+            {
+                if (keys[heap[child]] < keys[heap[smallest]])
+                {
+                    smallest = child;
+                }
+            }
+            if (smallest == index)
+            {
+                break;
+            }
+            swap_at(smallest, index);
+            index = smallest;
+        }
+    }
+
+    void swap_at(const int &index1, const int &index2)
+    {
+        std::swap(heap[index1], heap[index2]);
+        positions[heap[index1]] = index1;
+        positions[heap[index2]] = index2;
+    }
+
+    std::vector<int> heap;      // cities in the heap order
+    std::vector<double> keys;   // keys[city]
+    std::vector<int> positions; // city -> index in |heap| (-1 if not in the heap)
+};
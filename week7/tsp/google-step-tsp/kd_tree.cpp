@@ -0,0 +1,297 @@
+#include "kd_tree.hpp"
+
+// Squared distance between two cities.
+static double get_squared_distance(const City &city1, const City &city2)
+{
+    return (city1.x - city2.x) * (city1.x - city2.x) + (city1.y - city2.y) * (city1.y - city2.y);
+}
+
+KdTree::KdTree(const std::vector<City> &cities)
+    : cities(cities), order(cities.size()), splits_x(cities.size())
+{
+    for (int i = 0; i < (int)order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    build(0, order.size());
+
+    positions.resize(order.size());
+    for (int i = 0; i < (int)order.size(); ++i)
+    {
+        positions[order[i]] = i;
+    }
+    restore_all();
+}
+
+void KdTree::restore_all()
+{
+    is_removed.assign(order.size(), false);
+    remaining.resize(order.size());
+    // The subtree of mid = (lo + hi) / 2 has hi - lo cities.
+    std::vector<std::pair<int, int>> ranges(1, std::make_pair(0, (int)order.size()));
+    while (!ranges.empty())
+    {
+        int lo = ranges.back().first, hi = ranges.back().second;
+        ranges.pop_back();
+        if (lo >= hi)
+        {
+            continue;
+        }
+        int mid = (lo + hi) / 2;
+        remaining[mid] = hi - lo;
+        ranges.push_back(std::make_pair(lo, mid));
+        ranges.push_back(std::make_pair(mid + 1, hi));
+    }
+}
+
+void KdTree::remove_all()
+{
+    is_removed.assign(order.size(), true);
+    remaining.assign(order.size(), 0);
+}
+
+void KdTree::remove(const int &city)
+{
+    if (is_removed[city])
+    {
+        return;
+    }
+    is_removed[city] = true;
+    update_remaining(city, -1);
+}
+
+void KdTree::restore(const int &city)
+{
+    if (!is_removed[city])
+    {
+        return;
+    }
+    is_removed[city] = false;
+    update_remaining(city, 1);
+}
+
+// Walks down from the root to the node of |city|, adding |diff| to the counts on the way.
+void KdTree::update_remaining(const int &city, const int &diff)
+{
+    int position = positions[city];
+    int lo = 0, hi = order.size();
+    while (true)
+    {
+        int mid = (lo + hi) / 2;
+        remaining[mid] += diff;
+        if (position == mid)
+        {
+            break;
+        }
+        if (position < mid)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+}
+
+int KdTree::find_nearest_remaining(const int &city) const
+{
+    double best_distance = 0.0;
+    int best = -1;
+    search_remaining(0, order.size(), cities[city], best_distance, best);
+    return best;
+}
+
+// |best|, |best_distance|: the nearest remaining city found so far and its squared distance (-1 if none yet).
+void KdTree::search_remaining(const int &lo, const int &hi, const City &target, double &best_distance, int &best) const
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    if (remaining[mid] == 0)
+    {
+        return; // Every city in this subtree is removed.
+    }
+    int city = order[mid];
+    if (!is_removed[city])
+    {
+        double d = get_squared_distance(cities[city], target);
+        if (best == -1 || d < best_distance)
+        {
+            best = city;
+            best_distance = d;
+        }
+    }
+
+    double diff = splits_x[mid] ? target.x - cities[city].x : target.y - cities[city].y;
+    int near_lo = diff < 0 ? lo : mid + 1, near_hi = diff < 0 ? mid : hi;
+    int far_lo = diff < 0 ? mid + 1 : lo, far_hi = diff < 0 ? hi : mid;
+    search_remaining(near_lo, near_hi, target, best_distance, best);
+    if (best == -1 || diff * diff < best_distance)
+    {
+        search_remaining(far_lo, far_hi, target, best_distance, best);
+    }
+}
+
+std::vector<int> KdTree::find_remaining_within(const int &city, const double &radius) const
+{
+    std::vector<int> found;
+    search_within(0, order.size(), cities[city], city, radius * radius, found);
+    return found;
+}
+
+void KdTree::search_within(const int &lo, const int &hi, const City &target, const int &exclude, const double &squared_radius,
+                           std::vector<int> &found) const
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    if (remaining[mid] == 0)
+    {
+        return;
+    }
+    int city = order[mid];
+    if (!is_removed[city] && city != exclude && get_squared_distance(cities[city], target) <= squared_radius)
+    {
+        found.push_back(city);
+    }
+
+    // The other side of the split can only contain such cities if the split line is within the radius.
+    double diff = splits_x[mid] ? target.x - cities[city].x : target.y - cities[city].y;
+    if (diff < 0 || diff * diff <= squared_radius)
+    {
+        search_within(lo, mid, target, exclude, squared_radius, found);
+    }
+    if (diff >= 0 || diff * diff <= squared_radius)
+    {
+        search_within(mid + 1, hi, target, exclude, squared_radius, found);
+    }
+}
+
+// Builds the subtree of order[lo, hi).
+// Each node splits along the axis with the larger spread, which keeps the cells square on clustered inputs.
+void KdTree::build(const int &lo, const int &hi)
+{
+    if (hi - lo <= 1)
+    {
+        return;
+    }
+    double min_x = cities[order[lo]].x, max_x = min_x, min_y = cities[order[lo]].y, max_y = min_y;
+    for (int i = lo + 1; i < hi; ++i)
+    {
+        min_x = std::min(min_x, cities[order[i]].x);
+        max_x = std::max(max_x, cities[order[i]].x);
+        min_y = std::min(min_y, cities[order[i]].y);
+        max_y = std::max(max_y, cities[order[i]].y);
+    }
+    bool split_x = (max_x - min_x) >= (max_y - min_y);
+
+    int mid = (lo + hi) / 2;
+    std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, [&](int l, int r)
+                     { return split_x ? cities[l].x < cities[r].x : cities[l].y < cities[r].y; });
+    splits_x[mid] = split_x;
+    build(lo, mid);
+    build(mid + 1, hi);
+}
+
+std::vector<int> KdTree::find_nearest(const int &city, const int &k) const
+{
+    // Max-heap of (squared distance, city) holding the k nearest found so far.
+    std::vector<std::pair<double, int>> heap;
+    heap.reserve(k + 1);
+    search(0, order.size(), cities[city], city, k, false, heap);
+    std::sort_heap(heap.begin(), heap.end());
+
+    std::vector<int> nearest;
+    for (const std::pair<double, int> &found : heap)
+    {
+        nearest.push_back(found.second);
+    }
+    return nearest;
+}
+
+std::vector<int> KdTree::find_nearest_remaining(const int &city, const int &k) const
+{
+    std::vector<std::pair<double, int>> heap;
+    heap.reserve(k + 1);
+    search(0, order.size(), cities[city], city, k, true, heap);
+    std::sort_heap(heap.begin(), heap.end());
+
+    std::vector<int> nearest;
+    for (const std::pair<double, int> &found : heap)
+    {
+        nearest.push_back(found.second);
+    }
+    return nearest;
+}
+
+// |only_remaining|: whether to skip the removed cities.
+void KdTree::search(const int &lo, const int &hi, const City &target, const int &exclude, const int &k, const bool &only_remaining,
+                    std::vector<std::pair<double, int>> &heap) const
+{
+    if (lo >= hi || k <= 0)
+    {
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    if (only_remaining && remaining[mid] == 0)
+    {
+        return;
+    }
+    int city = order[mid];
+    if (city != exclude && !(only_remaining && is_removed[city]))
+    {
+        double d = get_squared_distance(cities[city], target);
+        if ((int)heap.size() < k || d < heap.front().first)
+        {
+            heap.push_back(std::make_pair(d, city));
+            std::push_heap(heap.begin(), heap.end());
+            if ((int)heap.size() > k)
+            {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.pop_back();
+            }
+        }
+    }
+
+    // Visit the side containing the target first, and the other side only if it can still contain a nearer city.
+    double diff = splits_x[mid] ? target.x - cities[city].x : target.y - cities[city].y;
+    if (diff < 0)
+    {
+        search(lo, mid, target, exclude, k, only_remaining, heap);
+        if ((int)heap.size() < k || diff * diff < heap.front().first)
+        {
+            search(mid + 1, hi, target, exclude, k, only_remaining, heap);
+        }
+    }
+    else
+    {
+        search(mid + 1, hi, target, exclude, k, only_remaining, heap);
+        if ((int)heap.size() < k || diff * diff < heap.front().first)
+        {
+            search(lo, mid, target, exclude, k, only_remaining, heap);
+        }
+    }
+}
+
+// Builds the candidate lists of all cities with a k-d tree, in O(N log N) on average.
+// |k| is reduced to (number of cities - 1) when there are not enough cities.
+NeighborLists get_neighbor_lists(const std::vector<City> &cities, const int &k)
+{
+    int num_of_cities = cities.size();
+    NeighborLists neighbors;
+    neighbors.k = std::max(0, std::min(k, num_of_cities - 1));
+    neighbors.cities.reserve((size_t)num_of_cities * neighbors.k);
+
+    KdTree tree(cities);
+    for (int city = 0; city < num_of_cities; ++city)
+    {
+        std::vector<int> nearest = tree.find_nearest(city, neighbors.k);
+        neighbors.cities.insert(neighbors.cities.end(), nearest.begin(), nearest.end());
+    }
+    return neighbors;
+}
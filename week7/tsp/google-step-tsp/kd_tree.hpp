@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "utils.hpp"
+
+// A k-d tree over the cities, built once in O(N log N).
+// The tree is implicit: |order| is rearranged so that the median of [lo, hi) is at mid = (lo + hi) / 2,
+// the left subtree is [lo, mid) and the right subtree is [mid + 1, hi).
+// Cities can also be removed from the tree (e.g. when visited), and then find_nearest_remaining() skips them.
+class KdTree
+{
+public:
+    explicit KdTree(const std::vector<City> &cities);
+
+    // Returns the |k| nearest cities of |city| (excluding |city| itself), nearest first.
+    // Removed cities are also included.
+    std::vector<int> find_nearest(const int &city, const int &k) const;
+
+    // Returns the nearest city to |city| among the cities not removed yet, or -1 if all are removed.
+    int find_nearest_remaining(const int &city) const;
+
+    // Returns the |k| nearest cities of |city| among the cities not removed yet (excluding |city| itself), nearest first.
+    std::vector<int> find_nearest_remaining(const int &city, const int &k) const;
+
+    // Returns the cities not removed yet within |radius| of |city| (excluding |city| itself), in no particular order.
+    std::vector<int> find_remaining_within(const int &city, const double &radius) const;
+
+    // Removes |city| in O(log N).
+    void remove(const int &city);
+
+    // Puts |city| back in O(log N).
+    void restore(const int &city);
+
+    // Puts all the removed cities back.
+    void restore_all();
+
+    // Removes all the cities, so that the tree can be filled up with restore().
+    void remove_all();
+
+private:
+    void build(const int &lo, const int &hi);
+    void search(const int &lo, const int &hi, const City &target, const int &exclude, const int &k, const bool &only_remaining,
+                std::vector<std::pair<double, int>> &heap) const;
+    void update_remaining(const int &city, const int &diff);
+    void search_remaining(const int &lo, const int &hi, const City &target, double &best_distance, int &best) const;
+    void search_within(const int &lo, const int &hi, const City &target, const int &exclude, const double &squared_radius,
+                       std::vector<int> &found) const;
+
+    const std::vector<City> &cities;
+    std::vector<int> order;       // cities in the tree order
+    std::vector<int> positions;   // city -> index in |order|
+    std::vector<bool> splits_x;   // splits_x[mid]: whether the node at mid splits by x (otherwise by y)
+    std::vector<int> remaining;   // remaining[mid]: number of cities not removed in the subtree of mid
+    std::vector<bool> is_removed; // is_removed[city]
+};
+
+// Candidate lists: the |k| nearest cities of every city, stored contiguously.
+// Local search only looks at these instead of all N cities.
+struct NeighborLists
+{
+    int k = 0;
+    std::vector<int> cities; // cities[i * k + n]: the n-th nearest city from city i
+
+    // The |k| nearest cities of |city|, nearest first.
+    const int *of(const int &city) const
+    {
+        return cities.data() + (size_t)city * k;
+    }
+};
+
+NeighborLists get_neighbor_lists(const std::vector<City> &, const int &);
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+
+// Returns the number of threads to use by default: the number of cores (1 if unknown).
+inline int get_default_num_of_threads()
+{
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+// Runs |worker|(thread_index) on |num_of_threads| threads, and waits until all of them finish.
+// The calling thread runs thread_index 0 itself.
+// Anything shared by the workers has to be read-only or atomic.
+template <class Worker>
+void run_on_threads(const int &num_of_threads, Worker worker)
+{
+    std::vector<std::thread> threads;
+    for (int thread_index = 1; thread_index < num_of_threads; ++thread_index)
+    {
+        threads.emplace_back(worker, thread_index);
+    }
+    worker(0);
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// A reusable barrier for |num_of_threads| threads, so that threads started once can work in rounds.
+// The last thread to arrive runs |completion|() before the others are released. The others are all waiting then,
+// so the completion may read and write anything the threads share, and they see the changes after the barrier.
+template <class Completion>
+class Barrier
+{
+public:
+    Barrier(const int &num_of_threads, Completion completion)
+        : num_of_threads(num_of_threads), completion(completion)
+    {
+    }
+
+    void arrive_and_wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        int arrived_generation = generation;
+        if (++num_of_arrived == num_of_threads)
+        {
+            completion();
+            num_of_arrived = 0;
+            ++generation;
+            released.notify_all();
+            return;
+        }
+        released.wait(lock, [&]
+                      { return generation != arrived_generation; });
+    }
+
+private:
+    const int num_of_threads;
+    Completion completion;
+    int num_of_arrived = 0; // threads waiting in this round
+    int generation = 0;     // number of finished rounds
+    std::mutex mutex;
+    std::condition_variable released;
+};
+
+// The best tour found so far by any thread. Every thread can read and publish it without locks.
+// A tour is published by swapping in a pointer to a new copy with compare-and-swap, only if its score is better.
+// A replaced copy may still be read by another thread, so it is not deleted at once but pushed on a lock-free
+// stack, and deleted by reclaim(), which has to be called while no other thread uses the slot.
+class BestTourSlot
+{
+public:
+    BestTourSlot(const std::vector<int> &tour, const double &score)
+        : best(new Entry{score, tour}), retired(nullptr)
+    {
+    }
+
+    ~BestTourSlot()
+    {
+        reclaim();
+        delete best.load();
+    }
+
+    double get_score() const
+    {
+        return best.load(std::memory_order_acquire)->score;
+    }
+
+    std::vector<int> get_tour() const
+    {
+        return best.load(std::memory_order_acquire)->tour;
+    }
+
+    // Publishes |tour| if |score| is better than the current best. Returns true if it is published.
+    bool publish(const std::vector<int> &tour, const double &score)
+    {
+        Entry *entry = nullptr; // Copied only when it is really better.
+        Entry *current = best.load(std::memory_order_acquire);
+        while (score < current->score)
+        {
+            if (entry == nullptr)
+            {
+                entry = new Entry{score, tour};
+            }
+            if (best.compare_exchange_weak(current, entry, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                retire(current);
+                return true;
+            }
+        }
+        delete entry;
+        return false;
+    }
+
+    // Deletes the replaced tours. No other thread may use the slot during this call.
+    void reclaim()
+    {
+        Entry *entry = retired.exchange(nullptr);
+        while (entry != nullptr)
+        {
+            Entry *next = entry->next_retired;
+            delete entry;
+            entry = next;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        double score;
+        std::vector<int> tour;
+        Entry *next_retired = nullptr; // the next one in the stack of replaced tours
+    };
+
+    void retire(Entry *entry)
+    {
+        entry->next_retired = retired.load(std::memory_order_relaxed);
+        while (!retired.compare_exchange_weak(entry->next_retired, entry, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::atomic<Entry *> best;
+    std::atomic<Entry *> retired; // top of the stack of replaced tours
+};
@@ -1,36 +1,40 @@
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <deque>
+#include <atomic>
 #include "utils.hpp"
+#include "distances.hpp"
+#include "kd_tree.hpp"
+#include "indexed_heap.hpp"
+#include "tour.hpp"
+#include "parallel.hpp"
 
 // Gets a tour using greedy algorithm.
 // From each city, moves to the nearest unvisited city.
-std::vector<int> get_greedy_tour(const int &start_city, const std::vector<std::vector<double>> &distances)
+// Visited cities are removed from |tree|, so each step is a nearest-neighbor query on the tree
+// instead of a scan of all the cities (O(N log N) on average instead of O(N^2)).
+std::vector<int> get_greedy_tour(const int &start_city, KdTree &tree)
 {
-    int num_of_cities = distances.size();
-    std::vector<bool> has_visited(num_of_cities, false);
     std::vector<int> greedy_tour;
+    tree.restore_all();
 
     int current_city = start_city;
 
     greedy_tour.push_back(current_city);
-    has_visited[current_city] = true;
+    tree.remove(current_city);
 
     while (true)
     {
         // Finds the nearest unvisited city.
-        int nearest_city = -1;
-        for (int next_city = 0; next_city < num_of_cities; ++next_city)
-        {
-            if (!has_visited[next_city] && (nearest_city == -1 || distances[current_city][next_city] < distances[current_city][nearest_city]))
-            {
-                nearest_city = next_city;
-            }
-        }
+        int nearest_city = tree.find_nearest_remaining(current_city);
         if (nearest_city == -1)
         { // When visited all city
             break;
         }
 
         current_city = nearest_city;
-        has_visited[nearest_city] = true;
+        tree.remove(nearest_city);
         greedy_tour.push_back(nearest_city);
     }
 
@@ -38,230 +42,1064 @@ std::vector<int> get_greedy_tour(const int &start_city, const std::vector<std::v
     return greedy_tour;
 }
 
-// Returns true when two edges are crossed.s
-// |index1|, |index2|: indices of starting points of the two edges.
-bool are_crossed(const std::vector<int> &tour, const int &index1, const int &index2, const std::vector<std::vector<double>> &distances)
+// Returns the index of the cell (x, y) along the Hilbert curve filling a 2^|order| x 2^|order| grid.
+uint64_t get_hilbert_index(uint32_t x, uint32_t y, const int &order)
+{
+    uint64_t index = 0;
+    for (uint32_t s = 1u << (order - 1); s > 0; s >>= 1)
+    {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        index += (uint64_t)s * s * ((3 * rx) ^ ry);
+        // Rotates the quadrant so that the curve inside it starts and ends at the right corners.
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = s - 1 - (x & (s - 1));
+                y = s - 1 - (y & (s - 1));
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+// Gets a tour by visiting the cities in the order of the Hilbert curve.
+// Only sorts the cities (O(N log N)), so it is instant even for huge inputs,
+// and the tour is about 25% longer than the optimal one on uniform inputs.
+std::vector<int> get_hilbert_tour(const std::vector<City> &cities)
+{
+    int num_of_cities = cities.size();
+    const int order = 16;
+    double min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+    for (int i = 0; i < num_of_cities; ++i)
+    {
+        if (i == 0 || cities[i].x < min_x) min_x = cities[i].x;
+        if (i == 0 || cities[i].x > max_x) max_x = cities[i].x;
+        if (i == 0 || cities[i].y < min_y) min_y = cities[i].y;
+        if (i == 0 || cities[i].y > max_y) max_y = cities[i].y;
+    }
+    // Maps the bounding square of the cities onto the grid.
+    double scale = ((1 << order) - 1) / std::max(1e-9, std::max(max_x - min_x, max_y - min_y));
+
+    std::vector<std::pair<uint64_t, int>> indices;
+    for (int i = 0; i < num_of_cities; ++i)
+    {
+        uint32_t x = (cities[i].x - min_x) * scale;
+        uint32_t y = (cities[i].y - min_y) * scale;
+        indices.push_back(std::make_pair(get_hilbert_index(x, y, order), i));
+    }
+    std::sort(indices.begin(), indices.end());
+
+    std::vector<int> hilbert_tour;
+    for (const std::pair<uint64_t, int> &index : indices)
+    {
+        hilbert_tour.push_back(index.second);
+    }
+    return hilbert_tour;
+}
+
+// Returns the representative of the set containing |city| (union-find with path halving).
+int find_root(std::vector<int> &parents, int city)
+{
+    while (parents[city] != city)
+    {
+        parents[city] = parents[parents[city]];
+        city = parents[city];
+    }
+    return city;
+}
+
+// Gets a tour using greedy edge algorithm.
+// Takes the candidate edges (each city and its candidate neighbors) from the shortest one,
+// and adds an edge unless one of its ends already has two edges or it closes a cycle.
+// The result is a set of paths, which are then joined by walking from the end of a path to
+// the nearest end of another path (found with |tree|).
+template <class Distances>
+std::vector<int> get_greedy_edge_tour(const Distances &distances, const NeighborLists &neighbors, KdTree &tree)
 {
     int num_of_cities = distances.size();
-    double length_of_edges = distances[tour[index1]][tour[(index1 + 1) % tour.size()]] + distances[tour[index2]][tour[(index2 + 1) % tour.size()]];
-    double length_of_rearranged_edges = distances[tour[index1]][tour[index2]] + distances[tour[(index1 + 1) % tour.size()]][tour[(index2 + 1) % tour.size()]];
 
-    return length_of_rearranged_edges < length_of_edges; // When two edges are crossed
+    std::vector<std::pair<double, std::pair<int, int>>> edges;
+    for (int city = 0; city < num_of_cities; ++city)
+    {
+        for (int n = 0; n < neighbors.k; ++n)
+        {
+            int neighbor = neighbors.of(city)[n];
+            edges.push_back(std::make_pair(distances(city, neighbor), std::make_pair(std::min(city, neighbor), std::max(city, neighbor))));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    std::vector<int> parents(num_of_cities);
+    for (int city = 0; city < num_of_cities; ++city)
+    {
+        parents[city] = city;
+    }
+    std::vector<std::pair<int, int>> adjacent(num_of_cities, std::make_pair(-1, -1)); // Up to two cities connected to each city.
+    for (const std::pair<double, std::pair<int, int>> &edge : edges)
+    {
+        int city1 = edge.second.first, city2 = edge.second.second;
+        if (adjacent[city1].second != -1 || adjacent[city2].second != -1)
+        {
+            continue; // A city cannot have more than two edges.
+        }
+        int root1 = find_root(parents, city1), root2 = find_root(parents, city2);
+        if (root1 == root2)
+        {
+            continue; // The edge would close a cycle.
+        }
+        parents[root1] = root2;
+        (adjacent[city1].first == -1 ? adjacent[city1].first : adjacent[city1].second) = city2;
+        (adjacent[city2].first == -1 ? adjacent[city2].first : adjacent[city2].second) = city1;
+    }
+
+    // Only the ends of the paths are left in the tree.
+    tree.restore_all();
+    int start_city = -1;
+    for (int city = 0; city < num_of_cities; ++city)
+    {
+        if (adjacent[city].second != -1)
+        {
+            tree.remove(city);
+        }
+        else if (start_city == -1)
+        {
+            start_city = city;
+        }
+    }
+
+    std::vector<int> greedy_edge_tour;
+    int current_city = start_city;
+    while (current_city != -1)
+    {
+        // Walks along the path from one end to the other.
+        tree.remove(current_city);
+        int previous_city = -1;
+        while (true)
+        {
+            greedy_edge_tour.push_back(current_city);
+            int next_city = adjacent[current_city].first != previous_city ? adjacent[current_city].first : adjacent[current_city].second;
+            if (next_city == -1)
+            {
+                break;
+            }
+            previous_city = current_city;
+            current_city = next_city;
+        }
+        tree.remove(current_city);
+        // Moves to the nearest end of another path.
+        current_city = tree.find_nearest_remaining(current_city);
+    }
+
+    // assert(check_tour(greedy_edge_tour, num_of_cities));
+    return greedy_edge_tour;
+}
+
+// Finds the cheapest place to insert |city| into the partial tour, next to one of |candidates|.
+// The partial tour is a doubly linked list |next|, |prev| (-1 for the cities not in it yet),
+// and the candidates not in it are skipped.
+// Returns (the increase of the tour length, the city after which |city| is inserted), or (infinity, -1) if there is no place.
+template <class Distances>
+std::pair<double, int> find_cheapest_insertion(const int &city, const int *candidates, const int &num_of_candidates,
+                                               const std::vector<int> &next, const std::vector<int> &prev, const Distances &distances)
+{
+    std::pair<double, int> cheapest(std::numeric_limits<double>::infinity(), -1);
+    for (int i = 0; i < num_of_candidates; ++i)
+    {
+        int candidate = candidates[i];
+        if (next[candidate] == -1)
+        {
+            continue;
+        }
+        // Tries both edges of |candidate|: (prev, candidate) and (candidate, next).
+        for (int after : {prev[candidate], candidate})
+        {
+            double cost = distances(after, city) + distances(city, next[after]) - distances(after, next[after]);
+            if (cost < cheapest.first)
+            {
+                cheapest = std::make_pair(cost, after);
+            }
+        }
+    }
+    return cheapest;
+}
+
+// Inserts |city| after |after| in the doubly linked list |next|, |prev|.
+void insert_after(const int &city, const int &after, std::vector<int> &next, std::vector<int> &prev)
+{
+    int before = next[after];
+    next[after] = city;
+    prev[city] = after;
+    next[city] = before;
+    prev[before] = city;
 }
 
-// Uncrosses crossed two edges.
-// |index1|, |index2|: indices of starting points of the two edges.
-std::vector<int> &uncross_edges(std::vector<int> &tour, const int &index1, const int &index2)
+// Converts the doubly linked list |next| into a tour starting from |start_city|.
+std::vector<int> get_tour_from_links(const int &start_city, const std::vector<int> &next)
 {
-    std::reverse(tour.begin() + index1 + 1, tour.begin() + index2 + 1);
+    std::vector<int> tour;
+    int city = start_city;
+    do
+    {
+        tour.push_back(city);
+        city = next[city];
+    } while (city != start_city);
     return tour;
 }
 
-// Performs two-opt algorithm.
-// When two edges (tour[index1]->tour[index1+1] and tour[index2]->tour[index2+1]) are crossing,
-// returns a tour made by uncrossing the two edges.
-// Otherwise, returns the given tour.
-// NOTE: index1 must be smaller than index2.
-std::vector<int> &two_opt(std::vector<int> &tour, const std::vector<std::vector<double>> &distances, const double &time_limit)
+// Returns referrers[city]: the cities having |city| in their candidate lists.
+std::vector<std::vector<int>> get_referrers(const NeighborLists &neighbors, const int &num_of_cities)
+{
+    std::vector<std::vector<int>> referrers(num_of_cities);
+    for (int city = 0; city < num_of_cities; ++city)
+    {
+        for (int n = 0; n < neighbors.k; ++n)
+        {
+            referrers[neighbors.of(city)[n]].push_back(city);
+        }
+    }
+    return referrers;
+}
+
+// Gets a tour using cheapest insertion algorithm.
+// Starting from a tour of city 0 alone, repeatedly inserts the city which makes the tour the least longer.
+// Insertion places are limited to the edges around the candidate neighbors of each city,
+// and the costs are kept in an indexed heap. Inserting a city only changes the edges around it,
+// so only the cities having it or its two tour neighbors in their candidate lists are updated.
+template <class Distances>
+std::vector<int> get_cheapest_insertion_tour(const Distances &distances, const NeighborLists &neighbors)
 {
     int num_of_cities = distances.size();
 
-    std::random_device seed_gen;
-    std::mt19937 random_engine(seed_gen());
+    std::vector<std::vector<int>> referrers = get_referrers(neighbors, num_of_cities);
+
+    std::vector<int> next(num_of_cities, -1), prev(num_of_cities, -1);
+    std::vector<int> tour_cities; // cities in the tour, in the order of insertion
+    next[0] = prev[0] = 0;
+    tour_cities.push_back(0);
+
+    IndexedHeap heap(num_of_cities);
+    std::vector<int> insertion_places(num_of_cities, -1); // the city after which each city is inserted
+    auto update = [&](const int &city)
+    {
+        std::pair<double, int> cheapest = find_cheapest_insertion(city, neighbors.of(city), neighbors.k, next, prev, distances);
+        insertion_places[city] = cheapest.second;
+        heap.push(city, cheapest.first);
+    };
+    for (int city = 1; city < num_of_cities; ++city)
+    {
+        update(city);
+    }
+
+    while (!heap.empty())
+    {
+        int city = heap.pop();
+        int after = insertion_places[city];
+        if (after == -1)
+        {
+            // None of the candidate neighbors is in the tour (e.g. an isolated cluster), so looks at the whole tour.
+            after = find_cheapest_insertion(city, tour_cities.data(), tour_cities.size(), next, prev, distances).second;
+        }
+        int before = next[after];
+        insert_after(city, after, next, prev);
+        tour_cities.push_back(city);
+
+        for (int changed : {after, before, city})
+        {
+            for (int referrer : referrers[changed])
+            {
+                if (heap.contains(referrer))
+                {
+                    update(referrer);
+                }
+            }
+        }
+    }
+
+    // assert(check_tour(cheapest_insertion_tour, num_of_cities));
+    return get_tour_from_links(0, next);
+}
+
+// Gets a tour using farthest insertion algorithm.
+// Starting from a tour of city 0 alone, repeatedly takes the city farthest from the tour,
+// and inserts it at the cheapest place next to one of its nearest cities in the tour.
+// The distance from each city to the tour is kept in an indexed heap. After inserting a city, only the cities
+// within the distance just taken (the largest one) can get nearer, so they are found with |tree| and updated.
+// The cities in the tour are kept in another k-d tree to find the nearest ones.
+template <class Distances>
+std::vector<int> get_farthest_insertion_tour(const Distances &distances, const std::vector<City> &cities, KdTree &tree)
+{
+    int num_of_cities = distances.size();
+    const int num_of_places = 5; // Number of the nearest cities in the tour whose edges are tried for insertion.
+
+    std::vector<int> next(num_of_cities, -1), prev(num_of_cities, -1);
+    next[0] = prev[0] = 0;
+    tree.restore_all();
+    tree.remove(0);
+    KdTree tour_tree(cities);
+    tour_tree.remove_all();
+    tour_tree.restore(0);
+
+    IndexedHeap heap(num_of_cities); // key: -(distance to the tour), so that the farthest city is on the top
+    for (int city = 1; city < num_of_cities; ++city)
+    {
+        heap.push(city, -distances(city, 0));
+    }
+
+    while (!heap.empty())
+    {
+        double farthest_distance = -heap.key(heap.top());
+        int city = heap.pop();
+        tree.remove(city);
+
+        std::vector<int> places = tour_tree.find_nearest_remaining(city, num_of_places);
+        int after = find_cheapest_insertion(city, places.data(), places.size(), next, prev, distances).second;
+        insert_after(city, after, next, prev);
+        tour_tree.restore(city);
+
+        for (int remaining : tree.find_remaining_within(city, farthest_distance))
+        {
+            double distance = distances(remaining, city);
+            if (distance < -heap.key(remaining))
+            {
+                heap.push(remaining, -distance);
+            }
+        }
+    }
+
+    // assert(check_tour(farthest_insertion_tour, num_of_cities));
+    return get_tour_from_links(0, next);
+}
+
+// Performs two-opt algorithm until no two edges can be uncrossed within the candidate neighbors
+// (a 2-opt local optimum), or |time_limit| seconds pass.
+// Takes a city a from a queue, and for each of its two tour neighbors b, looks for a candidate neighbor c of a
+// such that replacing (a, b) and (c, d) with (a, c) and (b, d) shortens the tour (d is the tour neighbor of c
+// on the same side as b). The candidates are sorted by distance, so the search stops as soon as d(a, c) >= d(a, b).
+// The first improving move is applied, and the four cities are queued again, together with the cities having
+// any of them as a candidate neighbor (a move from such a city may have become improving with the new edges).
+// A city with no improving move is left out of the queue (don't-look bit) until its edges or the edges of
+// its candidate neighbors change. A flip also reverses the direction of the path between the two edges
+// relative to the rest, which can make a move between two unchanged edges valid, so an empty queue alone
+// is not a local optimum: every city is queued once more, until a whole sweep finds no improving move.
+// |tour|: ArrayTour or TwoLevelList (see tour.hpp).
+template <class Tour, class Distances>
+void run_two_opt(Tour &tour, const Distances &distances, const NeighborLists &neighbors, const double &time_limit)
+{
+    int num_of_cities = distances.size();
+    if (neighbors.k == 0 || num_of_cities < 4)
+    {
+        return;
+    }
+
+    std::deque<int> queue;
+    for (int i = 0, city = 0; i < num_of_cities; ++i, city = tour.next(city))
+    {
+        queue.push_back(city);
+    }
+    std::vector<bool> is_queued(num_of_cities, true);
+    auto push = [&](const int &city)
+    {
+        if (!is_queued[city])
+        {
+            is_queued[city] = true;
+            queue.push_back(city);
+        }
+    };
+    std::vector<std::vector<int>> referrers = get_referrers(neighbors, num_of_cities);
 
-    // Choose two edges at random, and uncross them if they are crossed.
+    bool improved_since_sweep = false; // Whether the tour changed since all cities were queued.
     std::time_t start = std::time(NULL);
     while ((std::time(NULL) - start) < time_limit)
     {
-        // Choose index1 and index2 at random.
-        std::pair<int, int> indices = gen_random_indices(num_of_cities, random_engine);
-        if (are_crossed(tour, indices.first, indices.second, distances))
+        if (queue.empty())
         {
-            tour = uncross_edges(tour, indices.first, indices.second);
+            if (!improved_since_sweep)
+            {
+                break;
+            }
+            improved_since_sweep = false;
+            for (int city = 0; city < num_of_cities; ++city)
+            {
+                push(city);
+            }
+        }
+        int city_a = queue.front();
+        queue.pop_front();
+        is_queued[city_a] = false;
+
+        bool improved = false;
+        for (bool forward : {true, false}) // To the next city, then to the previous city.
+        {
+            int city_b = forward ? tour.next(city_a) : tour.prev(city_a);
+            double length_ab = distances(city_a, city_b);
+            for (int n = 0; n < neighbors.k; ++n)
+            {
+                int city_c = neighbors.of(city_a)[n];
+                double length_ac = distances(city_a, city_c);
+                if (length_ac >= length_ab)
+                {
+                    break; // The new edge (a, c) alone is already as long as the removed edge (a, b).
+                }
+                int city_d = forward ? tour.next(city_c) : tour.prev(city_c);
+                if (city_c == city_b || city_d == city_a)
+                {
+                    continue;
+                }
+                double score_diff = length_ac + distances(city_b, city_d) - length_ab - distances(city_c, city_d);
+                if (score_diff < -1e-9)
+                {
+                    if (forward)
+                    {
+                        tour.flip(city_a, city_b, city_c, city_d);
+                    }
+                    else
+                    {
+                        tour.flip(city_b, city_a, city_d, city_c); // The edges are (b, a) and (d, c) going forward.
+                    }
+                    for (int city : {city_a, city_b, city_c, city_d})
+                    {
+                        push(city);
+                        for (int referrer : referrers[city])
+                        {
+                            push(referrer);
+                        }
+                    }
+                    improved = improved_since_sweep = true;
+                    break;
+                }
+            }
+            if (improved)
+            {
+                break;
+            }
         }
     }
+}
 
-    // assert(check_tour(tour, num_of_cities));
+// Runs |improve| on |tour| held as |tour_type|:
+// "array" (ArrayTour) or "two-level" (TwoLevelList, faster flips for large inputs).
+template <class Improve>
+std::vector<int> &improve_tour(std::vector<int> &tour, const std::string &tour_type, Improve improve)
+{
+    if (tour_type == "two-level")
+    {
+        TwoLevelList list(tour);
+        improve(list);
+        tour = list.to_vector();
+    }
+    else
+    {
+        ArrayTour array(tour);
+        improve(array);
+        tour = array.to_vector();
+    }
+
+    // assert(check_tour(tour, tour.size()));
     return tour;
 }
 
-// Gets the change of score when inserting |subsequence| between main_tour[edge_start] and main_tour[edge_end].
-// |reverses|: whether to reverse the subsequence or not when inserting it to the main_tour.
-double get_score_diff(const int &edge_end, const bool &reverses, const std::vector<int> &main_tour, const std::vector<int> &subsequence, const std::vector<std::vector<double>> &distances)
+// Performs two-opt algorithm (run_two_opt()) on |tour| held as |tour_type|.
+template <class Distances>
+std::vector<int> &two_opt(std::vector<int> &tour, const Distances &distances, const NeighborLists &neighbors, const double &time_limit, const std::string &tour_type)
 {
-    int edge_start = (edge_end + main_tour.size() - 1) % main_tour.size();
-    if (reverses)
+    return improve_tour(tour, tour_type, [&](auto &tour_list)
+                        { run_two_opt(tour_list, distances, neighbors, time_limit); });
+}
+
+// Removes the edges (t1, t2) and (t3, t4), and adds (t2, t3) and (t1, t4).
+// t2 is next to t1, and t4 is next to t3 on the side of t1 (so that the tour stays one cycle).
+template <class Tour>
+void make_two_opt_move(Tour &tour, const int &t1, const int &t2, const int &t3, const int &t4)
+{
+    if (tour.next(t1) == t2)
     {
-        return distances[subsequence.back()][main_tour[edge_start]] +
-               distances[subsequence.front()][main_tour[edge_end]] -
-               distances[main_tour[edge_start]][main_tour[edge_end]];
+        tour.flip(t1, t2, t4, t3);
     }
     else
     {
-        return distances[subsequence.front()][main_tour[edge_start]] +
-               distances[subsequence.back()][main_tour[edge_end]] -
-               distances[main_tour[edge_start]][main_tour[edge_end]];
+        tour.flip(t2, t1, t3, t4);
     }
 }
 
-// Cuts out [indices.first, indices.second) from the |tour| and assign it to |subsequence|.
-// Rest of the |tour| is assigned to |main_tour|.
-void cut_out_subsequence(const std::vector<int> &tour, std::vector<int> &main_tour, std::vector<int> &subsequence, const std::pair<int, int> &indices)
+// Searches for a sequential move of Lin-Kernighan algorithm and applies it. Returns true if it improves the tour.
+// The edge (t1, t2) is already removed, and |gain| is the total length of the removed edges minus the added edges so far.
+// From the free end t2, adds an edge (t2, t3) to a candidate neighbor t3 and removes (t3, t4), which is done
+// as a 2-opt move keeping t1 fixed, so that the tour is always a valid cycle closed by the edge (t4, t1).
+// If closing there makes the tour shorter, stops. Otherwise goes deeper from t4, up to |max_depth| edges.
+// Only the best few t3 are tried at the first levels, and the best one below them.
+// An edge added in this move is never removed again, and the moves that do not lead to an improvement are undone.
+// |touched|: the cities whose edges changed are appended.
+template <class Tour, class Distances>
+bool search_lin_kernighan_move(Tour &tour, const Distances &distances, const NeighborLists &neighbors, const int &t1, const int &t2,
+                               const double &gain, const int &depth, std::vector<std::pair<int, int>> &added_edges, std::vector<int> &touched)
 {
-    int num_of_cities = tour.size();
-    for (int i = 0; i < num_of_cities; ++i)
+    const int max_depth = 12;
+    const int breadths[] = {5, 3}; // Number of t3 tried at depth 0, 1 (1 below them).
+    int breadth = depth < 2 ? breadths[depth] : 1;
+
+    // (gain after removing (t3, t4), t3, t4), the best first.
+    std::vector<std::pair<double, std::pair<int, int>>> steps;
+    bool t2_is_next = tour.next(t1) == t2;
+    for (int n = 0; n < neighbors.k; ++n)
     {
-        if (i == indices.first)
+        int t3 = neighbors.of(t2)[n];
+        double gain_after_adding = gain - distances(t2, t3);
+        if (gain_after_adding <= 0)
         {
-            for (; i < indices.second; ++i)
-            {
-                subsequence.push_back(tour[i]);
-            }
+            break; // The candidates are sorted by distance, so the rest cannot make a gain either.
+        }
+        int t4 = t2_is_next ? tour.prev(t3) : tour.next(t3);
+        if (t3 == t1 || t4 == t2)
+        {
+            continue;
+        }
+        bool is_added = false;
+        for (const std::pair<int, int> &edge : added_edges)
+        {
+            is_added |= (edge.first == t3 && edge.second == t4) || (edge.first == t4 && edge.second == t3);
+        }
+        if (!is_added)
+        {
+            steps.push_back(std::make_pair(gain_after_adding + distances(t3, t4), std::make_pair(t3, t4)));
         }
-        main_tour.push_back(tour[i]);
     }
-    return;
+    std::sort(steps.begin(), steps.end(), std::greater<std::pair<double, std::pair<int, int>>>());
+
+    for (int i = 0; i < std::min<int>(breadth, steps.size()); ++i)
+    {
+        double new_gain = steps[i].first;
+        int t3 = steps[i].second.first, t4 = steps[i].second.second;
+        make_two_opt_move(tour, t1, t2, t3, t4);
+        added_edges.push_back(std::make_pair(t2, t3));
+        if (new_gain - distances(t4, t1) > 1e-9 ||
+            (depth + 1 < max_depth && search_lin_kernighan_move(tour, distances, neighbors, t1, t4, new_gain, depth + 1, added_edges, touched)))
+        {
+            touched.push_back(t3);
+            touched.push_back(t4);
+            return true;
+        }
+        added_edges.pop_back();
+        make_two_opt_move(tour, t1, t4, t3, t2); // Undo.
+    }
+    return false;
 }
 
-// Inserts the subsequence to |main_tour|.
-// subsequence is inserted before main_tour[insert_index].
-std::vector<int> insert_subsequence(const std::vector<int> &main_tour, const std::vector<int> &subsequence, const int &insert_index, const bool &reverses_subsequence)
+// Performs Lin-Kernighan style local search until no improving move is found, or |time_limit| seconds pass.
+// Cities are taken from a queue with don't-look bits as in run_two_opt() (the cities whose edges changed and
+// the cities having them as candidate neighbors are queued again, and every city is queued again when the queue
+// gets empty, until a whole sweep finds nothing), and from each city t1,
+// a variable depth move (search_lin_kernighan_move()) starting by removing the edge to either tour neighbor is searched.
+// Depth 1 is a 2-opt move and depth 2 a sequential 3-opt move, so this finds strictly more than run_two_opt().
+// |tour|: ArrayTour or TwoLevelList (see tour.hpp).
+template <class Tour, class Distances>
+void run_lin_kernighan(Tour &tour, const Distances &distances, const NeighborLists &neighbors, const double &time_limit)
 {
-    int main_tour_size = main_tour.size();
-    std::vector<int> new_tour;
+    int num_of_cities = distances.size();
+    if (neighbors.k == 0 || num_of_cities < 5)
+    {
+        return;
+    }
 
-    for (int i = 0; i < main_tour_size; ++i)
+    std::deque<int> queue;
+    for (int i = 0, city = 0; i < num_of_cities; ++i, city = tour.next(city))
     {
-        if (i == insert_index)
+        queue.push_back(city);
+    }
+    std::vector<bool> is_queued(num_of_cities, true);
+    auto push = [&](const int &city)
+    {
+        if (!is_queued[city])
         {
-            if (reverses_subsequence)
+            is_queued[city] = true;
+            queue.push_back(city);
+        }
+    };
+    std::vector<std::vector<int>> referrers = get_referrers(neighbors, num_of_cities);
+
+    std::vector<std::pair<int, int>> added_edges;
+    std::vector<int> touched;
+    bool improved_since_sweep = false; // Whether the tour changed since all cities were queued.
+    std::time_t start = std::time(NULL);
+    while ((std::time(NULL) - start) < time_limit)
+    {
+        if (queue.empty())
+        {
+            if (!improved_since_sweep)
             {
-                for (int j = subsequence.size() - 1; j >= 0; --j)
-                {
-                    new_tour.push_back(subsequence[j]);
-                }
+                break;
+            }
+            improved_since_sweep = false;
+            for (int city = 0; city < num_of_cities; ++city)
+            {
+                push(city);
             }
-            else
+        }
+        int t1 = queue.front();
+        queue.pop_front();
+        is_queued[t1] = false;
+
+        for (bool forward : {true, false})
+        {
+            int t2 = forward ? tour.next(t1) : tour.prev(t1);
+            added_edges.clear();
+            touched.assign({t1, t2});
+            if (search_lin_kernighan_move(tour, distances, neighbors, t1, t2, distances(t1, t2), 0, added_edges, touched))
             {
-                for (int j = 0; j < subsequence.size(); ++j)
+                improved_since_sweep = true;
+                for (int city : touched)
                 {
-                    new_tour.push_back(subsequence[j]);
+                    push(city);
+                    for (int referrer : referrers[city])
+                    {
+                        push(referrer);
+                    }
                 }
+                break;
             }
         }
-        new_tour.push_back(main_tour[i]);
     }
+}
+
+// Performs Lin-Kernighan style local search (run_lin_kernighan()) on |tour| held as |tour_type|.
+template <class Distances>
+std::vector<int> &lin_kernighan(std::vector<int> &tour, const Distances &distances, const NeighborLists &neighbors, const double &time_limit, const std::string &tour_type)
+{
+    return improve_tour(tour, tour_type, [&](auto &tour_list)
+                        { run_lin_kernighan(tour_list, distances, neighbors, time_limit); });
+}
+
+// Gets the change of score when moving the segment (|front| ... |back|) from between |before| and |after|
+// to between |city1| and |city2|.
+// Only these six edges change, so this is O(1).
+// |reverses|: whether to reverse the segment or not when inserting it.
+template <class Distances>
+double get_score_diff(const int &front, const int &back, const int &before, const int &after, const int &city1, const int &city2, const bool &reverses, const Distances &distances)
+{
+    double removed_length = distances(before, front) + distances(back, after) + distances(city1, city2);
+    double added_length = distances(before, after) +
+                          (reverses ? distances(city1, back) + distances(front, city2) : distances(city1, front) + distances(back, city2));
+    return added_length - removed_length;
+}
+
+// Moves the segment tour[first, last) between tour[index] and tour[index + 1] (both outside the segment) in place.
+// The cities between the segment and the insertion place are rotated, and nothing is allocated.
+// |reverses|: whether to reverse the segment or not when inserting it.
+void move_segment(std::vector<int> &tour, const int &first, const int &last, const int &index, const bool &reverses)
+{
+    int length = last - first;
+    int new_first;
+    if (index >= last)
+    {
+        // The segment moves forward: tour[first, index] becomes (tour[last, index], segment).
+        std::rotate(tour.begin() + first, tour.begin() + last, tour.begin() + index + 1);
+        new_first = index + 1 - length;
+    }
+    else
+    {
+        // The segment moves backward: tour[index + 1, last) becomes (segment, tour[index + 1, first)).
+        std::rotate(tour.begin() + index + 1, tour.begin() + first, tour.begin() + last);
+        new_first = index + 1;
+    }
+    if (reverses)
+    {
+        std::reverse(tour.begin() + new_first, tour.begin() + new_first + length);
+    }
+}
+
+// The range of the temperature of simulated annealing algorithm.
+const double start_temp = 1.75;
+const double end_temp = 0.05;
 
-    // assert(check_tour(new_tour, new_tour.size()));
-    return new_tour;
+// Returns the temperature of simulated annealing algorithm at the current time.
+// It decreases linearly from start_temp to end_temp in |time_limit| seconds.
+double get_temperature(const std::time_t &start_time, const double &time_limit)
+{
+    std::time_t current_time = std::time(NULL);
+    // return start_temp * std::pow(end_temp / start_temp, (double)(current_time - start_time) / time_limit);
+    return start_temp + (end_temp - start_temp) * (double)(current_time - start_time) / time_limit;
 }
 
 // Returns the probability to change to the new tour.
 // Probability is based on simulated annealing algorithm.
 // |score_diff|: (score of the new tour) - (score of the current tour)
-double get_transition_probability(const std::time_t &start_time, const double &time_limit, const double &score_diff)
+double get_transition_probability(const double &temp, const double &score_diff)
 {
-    std::time_t current_time = std::time(NULL);
-    double start_temp = 1.75;
-    double end_temp = 0.05;
-    // double temp = start_temp * std::pow(end_temp / start_temp, (double)(current_time - start_time) / time_limit);
-    double temp = start_temp + (end_temp - start_temp) * (double)(current_time - start_time) / time_limit;
     return std::exp(-score_diff / temp); // Minus is needed because smaller score is better.
 }
 
-// Cuts out subsequences randomly and connects it to another place of rest of the tour.
-// Whether to connect subsequence or not is judged using simulated annealing algorithm.
-std::vector<int> &move_subsequence(std::vector<int> &tour, const std::vector<std::vector<double>> &distances, const double &time_limit)
+// Cuts out a subsequence randomly and connects it to another place of rest of the tour.
+// Whether to connect subsequence or not is judged using simulated annealing algorithm at |temp|.
+// Everything is done in place on |tour|: the score change of each insertion place is computed from the six edges
+// around it (get_score_diff), and an accepted move only rotates the cities in between (move_segment).
+// Returns the change of score (0 if the subsequence is not moved). |tour| needs at least 3 cities.
+template <class Distances>
+double try_move_subsequence(std::vector<int> &tour, const Distances &distances, const double &temp, std::mt19937 &random_engine)
+{
+    int num_of_cities = distances.size();
+    std::uniform_real_distribution<double> random_uniform(0, 1);
+
+    // Choose the subsequence tour[first, last) at random (last < num_of_cities).
+    std::pair<int, int> indices = gen_random_indices(num_of_cities, random_engine);
+    int first = indices.first, last = indices.second;
+
+    int front = tour[first], back = tour[last - 1];
+    int before = tour[(first + num_of_cities - 1) % num_of_cities], after = tour[last];
+
+    // Try the places (between tour[index] and tour[index + 1]) in the tour order.
+    // The edges touching the subsequence are skipped, so the original place is not tried.
+    for (int index = (first == 0 ? last : 0); index < (first == 0 ? num_of_cities - 1 : num_of_cities); ++index)
+    {
+        if (index == first - 1)
+        {
+            index = last; // Jumps over the subsequence.
+        }
+        int city1 = tour[index], city2 = tour[index + 1 == num_of_cities ? 0 : index + 1];
+        for (int j = 0; j <= 1; ++j)
+        {
+            bool insert_reverses = (j == 0);
+
+            // Judge whether to insert the subsequence or not.
+            double score_change = get_score_diff(front, back, before, after, city1, city2, insert_reverses, distances);
+            // This statement is true with probability of min(transition_probability, 1).
+            // An improving move is always accepted, so exp() and the random number are skipped for it.
+            if (score_change <= 0 || random_uniform(random_engine) < get_transition_probability(temp, score_change))
+            {
+                move_segment(tour, first, last, index, insert_reverses);
+                // check_tour(tour, num_of_cities);
+                return score_change;
+            }
+        }
+    }
+    return 0;
+}
+
+// Moves subsequences (try_move_subsequence()) until |time_limit| seconds pass,
+// lowering the temperature linearly from start_temp to end_temp.
+template <class Distances>
+std::vector<int> &move_subsequence(std::vector<int> &tour, const Distances &distances, const double &time_limit)
 {
     int num_of_cities = distances.size();
+    if (num_of_cities < 3)
+    {
+        return tour;
+    }
 
     std::random_device seed_gen;
     std::mt19937 random_engine(seed_gen());
-    std::uniform_real_distribution<double> random_uniform(0, 1);
 
-    // Choose two edges at random, and uncross them if they are crossed.
     std::time_t start = std::time(NULL);
     while ((std::time(NULL) - start) < time_limit)
     {
-        // Choose index1 and index2 at random.
-        std::pair<int, int> indices = gen_random_indices(num_of_cities, random_engine);
-        std::vector<int> main_tour, subsequence;
-        cut_out_subsequence(tour, main_tour, subsequence, indices);
+        double temp = get_temperature(start, time_limit); // The clock is read once per subsequence, not per place.
+        try_move_subsequence(tour, distances, temp, random_engine);
+    }
+
+    // assert(check_tour(tour, num_of_cities));
+    return tour;
+}
+
+// Parallel tempering version of move_subsequence().
+// Runs one replica of the tour per thread, each at a fixed temperature spread geometrically from end_temp (coldest)
+// to start_temp (hottest). Every epoch, each replica tries |num_of_tries| subsequences on its own thread with
+// its own random engine. Then the replicas at adjacent temperatures are swapped with probability
+// min(1, exp((1 / T_i - 1 / T_j) * (E_i - E_j))) (Metropolis rule), so good tours drift to the cold end
+// and bad ones get heated up again. The threads are started once and meet at a barrier after every epoch,
+// where the last one to arrive does the swaps.
+// The best tour seen by any replica is published to a BestTourSlot without locks. Each replica keeps its score
+// up to date from the score changes, so a tour is copied only when that score beats the published one.
+template <class Distances>
+std::vector<int> &move_subsequence_in_parallel(std::vector<int> &tour, const Distances &distances, const double &time_limit, const int &num_of_threads)
+{
+    int num_of_cities = distances.size();
+    int num_of_replicas = num_of_threads;
+    if (num_of_cities < 3 || num_of_replicas < 2)
+    {
+        return move_subsequence(tour, distances, time_limit);
+    }
+    const int num_of_tries = 100;
+
+    std::random_device seed_gen;
+    std::vector<std::vector<int>> replicas(num_of_replicas, tour);
+    std::vector<double> scores(num_of_replicas, get_score(tour, distances));
+    std::vector<double> temps(num_of_replicas);
+    std::vector<std::mt19937> random_engines;
+    for (int i = 0; i < num_of_replicas; ++i)
+    {
+        temps[i] = end_temp * std::pow(start_temp / end_temp, (double)i / (num_of_replicas - 1));
+        random_engines.push_back(std::mt19937(seed_gen()));
+    }
+    std::uniform_real_distribution<double> random_uniform(0, 1);
+    BestTourSlot best(tour, scores[0]);
+
+    std::time_t start = std::time(NULL);
+    int epoch = 0;
+    bool finished = false; // Written only between the epochs (by the barrier).
+    auto end_epoch = [&]()
+    {
+        best.reclaim(); // Every thread is waiting at the barrier now.
 
-        for (int insert_index = 0; insert_index < main_tour.size(); ++insert_index)
+        // Swap the pairs (0, 1), (2, 3), ... and (1, 2), (3, 4), ... in turn.
+        for (int i = epoch % 2; i + 1 < num_of_replicas; i += 2)
         {
-            if (insert_index != indices.first)
+            scores[i] = get_score(replicas[i], distances); // Also clears the rounding errors of the sums.
+            scores[i + 1] = get_score(replicas[i + 1], distances);
+            double exponent = (1 / temps[i] - 1 / temps[i + 1]) * (scores[i] - scores[i + 1]);
+            if (exponent >= 0 || random_uniform(random_engines[0]) < std::exp(exponent))
             {
-                for (int j = 0; j <= 1; ++j)
-                {
-                    bool insert_reverses = (j == 0);
-
-                    // Judge whether to insert the subsequence or not.
-                    double score_change = get_score_diff(insert_index, insert_reverses, main_tour, subsequence, distances) - get_score_diff(indices.first, false, main_tour, subsequence, distances);
-                    double transition_probability = get_transition_probability(start, time_limit, score_change);
+                std::swap(replicas[i], replicas[i + 1]);
+                std::swap(scores[i], scores[i + 1]);
+            }
+        }
+        ++epoch;
+        finished = (std::time(NULL) - start) >= time_limit;
+    };
+    Barrier barrier(num_of_replicas, end_epoch);
 
-                    if (random_uniform(random_engine) < transition_probability) // This statement is true with probability of min(transition_probability, 1).
-                    {
-                        tour = insert_subsequence(main_tour, subsequence, insert_index, insert_reverses);
-                        // check_tour(tour, num_of_cities);
-                        break;
-                    }
+    auto run_replica = [&](const int &replica)
+    {
+        while (!finished)
+        {
+            for (int i = 0; i < num_of_tries; ++i)
+            {
+                double score_change = try_move_subsequence(replicas[replica], distances, temps[replica], random_engines[replica]);
+                scores[replica] += score_change;
+                if (score_change < 0 && scores[replica] < best.get_score())
+                {
+                    best.publish(replicas[replica], scores[replica]);
                 }
             }
+            barrier.arrive_and_wait();
         }
-    }
+    };
+    run_on_threads(num_of_replicas, run_replica);
 
+    tour = best.get_tour();
     // assert(check_tour(tour, num_of_cities));
     return tour;
 }
 
+// Settings of get_shortest_tour(), given from the command line.
+struct SolverOptions
+{
+    int num_of_starts = 0;                // Number of start cities tried for the initial tour (0: every 64th city).
+    double start_two_opt_time = 2;        // Time limit (seconds) of two-opt for each start city.
+    std::string construction = "greedy";  // Initial tour: "greedy", "hilbert", "greedy-edge", "cheapest-insertion" or "farthest-insertion".
+    std::string tour_type = "array";      // Tour representation of the local search: "array" or "two-level".
+    std::string improvement = "two-opt";  // Local search after the initial tour: "two-opt" or "lin-kernighan".
+    int num_of_threads = 1;               // Number of threads for the multi-start search and parallel tempering.
+    bool uses_parallel_tempering = false; // Whether to move subsequences with parallel tempering.
+};
+
 // Calculates the shortest tour to visit all the cities and return to the start.
 // If the shortest tour is 0 -> 2 -> 1, returns std::vector{0, 2, 1}.
-std::vector<int> get_shortest_tour(const std::vector<std::vector<double>> &distances)
+// |neighbors|: candidate neighbors of each city, used by the local search.
+template <class Distances>
+std::vector<int> get_shortest_tour(const std::vector<City> &cities, const Distances &distances, const NeighborLists &neighbors, const SolverOptions &options)
 {
     int num_of_cities = distances.size();
+    KdTree tree(cities);
 
-    // Try greedy & two-opt algorithm from different start points,
-    // and choose the one with the best score.
-    int best_start = -1;
-    double best_score = -1;
-
-    for (int start = 0; start < num_of_cities; start += 64)
+    std::vector<int> shortest_tour;
+    if (options.construction == "hilbert")
     {
-        std::vector<int> tour = get_greedy_tour(start, distances);
-        tour = two_opt(tour, distances, 2);
-        double score = get_score(tour, distances);
-        if (best_start == -1 || score < best_score)
-        {
-            best_score = score;
-            best_start = start;
-        }
+        shortest_tour = get_hilbert_tour(cities);
+    }
+    else if (options.construction == "greedy-edge")
+    {
+        shortest_tour = get_greedy_edge_tour(distances, neighbors, tree);
+    }
+    else if (options.construction == "cheapest-insertion")
+    {
+        shortest_tour = get_cheapest_insertion_tour(distances, neighbors);
+    }
+    else if (options.construction == "farthest-insertion")
+    {
+        shortest_tour = get_farthest_insertion_tour(distances, cities, tree);
     }
+    else
+    {
+        // Try greedy & two-opt algorithm from different start points,
+        // and choose the one with the best score.
+        // The start points are spread evenly over the city indices.
+        // The starts are independent, so they are shared out among the threads: each thread takes the next start
+        // from |next_start| and uses its own k-d tree (which get_greedy_tour() modifies). Only |distances| and
+        // |neighbors| are shared, read-only. Each thread keeps the best (score, tour) of its own starts,
+        // and they are reduced after all threads finish, so the winning tour is kept as it is.
+        int num_of_starts = options.num_of_starts > 0 ? std::min(options.num_of_starts, num_of_cities) : (num_of_cities + 63) / 64;
+        int num_of_threads = std::min(options.num_of_threads, num_of_starts);
+        std::vector<std::pair<double, std::vector<int>>> best_of_threads(num_of_threads, std::make_pair(std::numeric_limits<double>::max(), std::vector<int>()));
+        std::atomic<int> next_start(0);
 
-    // std::cout << "Start: " << best_start << std::endl;
-    std::vector<int> shortest_tour = get_greedy_tour(best_start, distances);
-    std::cout << "Score(greedy): " << get_score(shortest_tour, distances) << std::endl;
-    shortest_tour = two_opt(shortest_tour, distances, 120);
-    std::cout << "Score(two-opt): " << get_score(shortest_tour, distances) << std::endl;
-    shortest_tour = move_subsequence(shortest_tour, distances, 7200);
+        auto try_starts = [&](const int &thread_index)
+        {
+            KdTree thread_tree(cities);
+            std::pair<double, std::vector<int>> &best = best_of_threads[thread_index];
+            for (int i = next_start++; i < num_of_starts; i = next_start++)
+            {
+                int start = (long long)i * num_of_cities / num_of_starts;
+                std::vector<int> tour = get_greedy_tour(start, thread_tree);
+                tour = two_opt(tour, distances, neighbors, options.start_two_opt_time, options.tour_type);
+                double score = get_score(tour, distances);
+                if (score < best.first)
+                {
+                    best.first = score;
+                    best.second = std::move(tour);
+                }
+            }
+        };
+        run_on_threads(num_of_threads, try_starts);
+        shortest_tour = std::move(std::min_element(best_of_threads.begin(), best_of_threads.end(),
+                                                   [](const std::pair<double, std::vector<int>> &l, const std::pair<double, std::vector<int>> &r)
+                                                   { return l.first < r.first; })
+                                      ->second);
+    }
+    std::cout << "Score(" << options.construction << "): " << get_score(shortest_tour, distances) << std::endl;
+    if (options.improvement == "lin-kernighan")
+    {
+        shortest_tour = lin_kernighan(shortest_tour, distances, neighbors, 120, options.tour_type);
+    }
+    else
+    {
+        shortest_tour = two_opt(shortest_tour, distances, neighbors, 120, options.tour_type);
+    }
+    std::cout << "Score(" << options.improvement << "): " << get_score(shortest_tour, distances) << std::endl;
+    if (options.uses_parallel_tempering)
+    {
+        shortest_tour = move_subsequence_in_parallel(shortest_tour, distances, 7200, options.num_of_threads);
+    }
+    else
+    {
+        shortest_tour = move_subsequence(shortest_tour, distances, 7200);
+    }
     std::cout << "Score(final): " << get_score(shortest_tour, distances) << std::endl;
 
     assert(check_tour(shortest_tour, num_of_cities));
     return shortest_tour;
 }
 
+// Solves the TSP for |distances| and outputs the tour to |output_file|.
+template <class Distances>
+void solve(const std::vector<City> &cities, const Distances &distances, const NeighborLists &neighbors, const SolverOptions &options, const std::string &output_file)
+{
+    std::vector<int> shortest_tour = get_shortest_tour(cities, distances, neighbors, options);
+    print_tour(output_file, shortest_tour);
+}
+
 int main(int argc, char *argv[])
 {
     if (argc <= 2)
     {
         std::cerr << "Designate the input and output files." << std::endl;
+        std::cerr << "Usage: " << argv[0] << " input_file output_file [--distances=packed|computed|cached] [--neighbors=K] [--construct=greedy|hilbert|greedy-edge|cheapest-insertion|farthest-insertion] [--starts=N|all] [--start-time=SEC] [--tour=array|two-level] [--improve=two-opt|lin-kernighan] [--threads=N] [--anneal=linear|tempering]" << std::endl;
         std::exit(1);
     }
 
+    // How to hold the distances (see distances.hpp).
+    // Computing each distance from the coordinates is faster than looking it up in the matrix or the cache
+    // (input_7: 200 subsequence tries take 0.11 s computed, 0.25 s packed, 0.20 s cached), so it is the default.
+    std::string distances_type = "computed";
+    int num_of_neighbors = 10; // Size of the candidate lists.
+    // How to hold the tour in the local search (see tour.hpp).
+    // By default, the two-level list is used for large inputs, where reversing the array dominates.
+    std::string tour_type = "auto";
+    SolverOptions options;
+    options.num_of_threads = get_default_num_of_threads();
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--distances=", 0) == 0)
+        {
+            distances_type = arg.substr(12);
+        }
+        else if (arg.rfind("--neighbors=", 0) == 0)
+        {
+            num_of_neighbors = std::stoi(arg.substr(12));
+        }
+        else if (arg.rfind("--construct=", 0) == 0)
+        {
+            options.construction = arg.substr(12);
+            if (options.construction != "greedy" && options.construction != "hilbert" && options.construction != "greedy-edge" &&
+                options.construction != "cheapest-insertion" && options.construction != "farthest-insertion")
+            {
+                std::cerr << "Unknown construction: " << options.construction << std::endl;
+                std::exit(1);
+            }
+        }
+        else if (arg.rfind("--improve=", 0) == 0)
+        {
+            options.improvement = arg.substr(10);
+            if (options.improvement != "two-opt" && options.improvement != "lin-kernighan")
+            {
+                std::cerr << "Unknown improvement: " << options.improvement << std::endl;
+                std::exit(1);
+            }
+        }
+        else if (arg.rfind("--threads=", 0) == 0)
+        {
+            options.num_of_threads = std::max(1, std::stoi(arg.substr(10)));
+        }
+        else if (arg == "--anneal=linear" || arg == "--anneal=tempering")
+        {
+            options.uses_parallel_tempering = (arg == "--anneal=tempering");
+        }
+        else if (arg.rfind("--tour=", 0) == 0)
+        {
+            tour_type = arg.substr(7);
+        }
+        else if (arg == "--starts=all")
+        {
+            options.num_of_starts = INT_MAX;
+        }
+        else if (arg.rfind("--starts=", 0) == 0)
+        {
+            options.num_of_starts = std::stoi(arg.substr(9));
+        }
+        else if (arg.rfind("--start-time=", 0) == 0)
+        {
+            options.start_two_opt_time = std::stod(arg.substr(13));
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            std::exit(1);
+        }
+    }
+
     std::vector<City> cities = read_input(argv[1]);
-    std::vector<std::vector<double>> distances = get_distances(cities);
-    std::vector<int> shortest_tour = get_shortest_tour(distances);
-    print_tour(argv[2], shortest_tour);
+    // Candidate lists are built once and shared by every stage.
+    NeighborLists neighbors = get_neighbor_lists(cities, num_of_neighbors);
+    if (tour_type == "auto")
+    {
+        tour_type = cities.size() <= 50000 ? "array" : "two-level";
+    }
+    if (tour_type != "array" && tour_type != "two-level")
+    {
+        std::cerr << "Unknown tour: " << tour_type << std::endl;
+        std::exit(1);
+    }
+    options.tour_type = tour_type;
+
+    if (distances_type == "packed")
+    {
+        solve(cities, PackedDistances(cities), neighbors, options, argv[2]);
+    }
+    else if (distances_type == "computed")
+    {
+        solve(cities, ComputedDistances(cities), neighbors, options, argv[2]);
+    }
+    else if (distances_type == "cached")
+    {
+        solve(cities, NeighborCachedDistances(cities, neighbors), neighbors, options, argv[2]);
+    }
+    else
+    {
+        std::cerr << "Unknown distances: " << distances_type << std::endl;
+        std::exit(1);
+    }
 
     std::exit(0);
 }
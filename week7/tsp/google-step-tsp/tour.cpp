@@ -0,0 +1,148 @@
+#include <cmath>
+#include "tour.hpp"
+
+TwoLevelList::TwoLevelList(const std::vector<int> &tour)
+    : positions(tour.size()), segment_of(tour.size())
+{
+    rebuild(tour);
+}
+
+// Lays out the cities in the order of |tour| again, in segments of sqrt(N) cities without reverse bits.
+void TwoLevelList::rebuild(const std::vector<int> &tour)
+{
+    cities = tour;
+    segment_size = std::max(1, (int)std::sqrt((double)cities.size()));
+    segments.clear();
+    order.clear();
+    for (int begin = 0; begin < (int)cities.size(); begin += segment_size)
+    {
+        Segment segment;
+        segment.begin = begin;
+        segment.end = std::min(begin + segment_size, (int)cities.size());
+        segment.rank = segments.size();
+        for (int i = segment.begin; i < segment.end; ++i)
+        {
+            positions[cities[i]] = i;
+            segment_of[i] = segments.size();
+        }
+        order.push_back(segments.size());
+        segments.push_back(segment);
+    }
+}
+
+std::pair<int, int> TwoLevelList::get_key(const int &city) const
+{
+    int position = positions[city];
+    const Segment &segment = segments[segment_of[position]];
+    return std::make_pair(segment.rank, segment.reversed ? segment.end - 1 - position : position - segment.begin);
+}
+
+bool TwoLevelList::between(const int &a, const int &b, const int &c) const
+{
+    std::pair<int, int> key_a = get_key(a), key_b = get_key(b), key_c = get_key(c);
+    if (key_a <= key_c)
+    {
+        return key_a <= key_b && key_b <= key_c;
+    }
+    return key_a <= key_b || key_b <= key_c;
+}
+
+// Splits the segment of |city| so that |city| is the first city of its segment.
+// The latter part becomes a new segment right after the original one, in O(sqrt(N)).
+void TwoLevelList::split_before(const int &city)
+{
+    int position = positions[city];
+    int index = segment_of[position];
+    if (get_first(index) == city)
+    {
+        return;
+    }
+
+    Segment latter = segments[index];
+    if (segments[index].reversed)
+    {
+        // Visited from end - 1 down to begin, so [position + 1, end) comes first.
+        latter.end = position + 1;
+        segments[index].begin = position + 1;
+    }
+    else
+    {
+        latter.begin = position;
+        segments[index].end = position;
+    }
+    latter.rank = segments[index].rank + 1;
+    for (int i = latter.begin; i < latter.end; ++i)
+    {
+        segment_of[i] = segments.size();
+    }
+    order.insert(order.begin() + latter.rank, segments.size());
+    segments.push_back(latter);
+    for (int rank = latter.rank + 1; rank < (int)order.size(); ++rank)
+    {
+        segments[order[rank]].rank = rank;
+    }
+}
+
+void TwoLevelList::flip(const int &a, const int &b, const int &c, const int &d)
+{
+    if (a == c || b == d)
+    {
+        return;
+    }
+    // Makes the path b..c (and so the path d..a) consist of whole segments.
+    split_before(b);
+    split_before(d);
+
+    int num_of_segments = order.size();
+    int start = segments[segment_of[positions[b]]].rank;
+    int end = segments[segment_of[positions[c]]].rank;
+    int count = (end - start + num_of_segments) % num_of_segments + 1;
+    if (count * 2 > num_of_segments)
+    {
+        // Reverses the path d..a instead, which has fewer segments.
+        start = segments[segment_of[positions[d]]].rank;
+        count = num_of_segments - count;
+    }
+
+    // Reverses the order of the segments and their directions.
+    for (int i = 0; i < count / 2; ++i)
+    {
+        std::swap(order[(start + i) % num_of_segments], order[(start + count - 1 - i) % num_of_segments]);
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        int rank = (start + i) % num_of_segments;
+        segments[order[rank]].reversed = !segments[order[rank]].reversed;
+        segments[order[rank]].rank = rank;
+    }
+
+    if (num_of_segments > 2 * ((size() + segment_size - 1) / segment_size))
+    {
+        rebuild(to_vector());
+    }
+}
+
+std::vector<int> TwoLevelList::to_vector() const
+{
+    std::vector<int> tour;
+    tour.reserve(cities.size());
+    for (int index : order)
+    {
+        const Segment &segment = segments[index];
+        if (segment.reversed)
+        {
+            for (int i = segment.end - 1; i >= segment.begin; --i)
+            {
+                tour.push_back(cities[i]);
+            }
+        }
+        else
+        {
+            for (int i = segment.begin; i < segment.end; ++i)
+            {
+                tour.push_back(cities[i]);
+            }
+        }
+    }
+    return tour;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+
+// Tour representations for the local search.
+// The local search takes one of the classes below as |tour|, and only uses
+//   tour.size()           : the number of cities
+//   tour.next(a)          : the city after |a|
+//   tour.prev(a)          : the city before |a|
+//   tour.between(a, b, c) : whether |b| is on the way from |a| to |c| (going forward, both ends included)
+//   tour.flip(a, b, c, d) : replaces the edges (a, b) and (c, d) with (a, c) and (b, d), where b = next(a) and d = next(c)
+//   tour.to_vector()      : the cities in the tour order
+// flip() reverses either the path b..c or the path d..a, whichever is cheaper,
+// so the direction of the whole tour may change, and next/prev have to be asked again after it.
+
+// The tour as an array with a city -> index array.
+// next/prev/between are O(1), and flip() is O(N) (reverses up to N/2 cities).
+class ArrayTour
+{
+public:
+    explicit ArrayTour(const std::vector<int> &tour)
+        : cities(tour), positions(tour.size())
+    {
+        for (int i = 0; i < (int)cities.size(); ++i)
+        {
+            positions[cities[i]] = i;
+        }
+    }
+
+    int size() const
+    {
+        return cities.size();
+    }
+
+    int next(const int &city) const
+    {
+        int position = positions[city] + 1;
+        return cities[position == size() ? 0 : position];
+    }
+
+    int prev(const int &city) const
+    {
+        int position = positions[city];
+        return cities[position == 0 ? size() - 1 : position - 1];
+    }
+
+    bool between(const int &a, const int &b, const int &c) const
+    {
+        int position_a = positions[a], position_b = positions[b], position_c = positions[c];
+        if (position_a <= position_c)
+        {
+            return position_a <= position_b && position_b <= position_c;
+        }
+        return position_a <= position_b || position_b <= position_c;
+    }
+
+    // Reversing cities[index1+1..index2] and reversing the rest (cities[index2+1..index1], wrapping around)
+    // give the same cycle, so the shorter one is reversed.
+    // Only the positions of |a| and |c| are needed. |b| and |d| are only checked against them.
+    void flip(const int &a, const int &b, const int &c, const int &d)
+    {
+        assert(next(a) == b && next(c) == d);
+        int index1 = std::min(positions[a], positions[c]), index2 = std::max(positions[a], positions[c]);
+        int left = index1 + 1, right = index2;
+        if ((index2 - index1) * 2 > size())
+        {
+            left = index2 + 1;
+            right = index1 + size();
+        }
+        for (; left < right; ++left, --right)
+        {
+            int &city1 = cities[left % size()], &city2 = cities[right % size()];
+            std::swap(city1, city2);
+            positions[city1] = left % size();
+            positions[city2] = right % size();
+        }
+    }
+
+    std::vector<int> to_vector() const
+    {
+        return cities;
+    }
+
+private:
+    std::vector<int> cities;    // cities in the tour order
+    std::vector<int> positions; // city -> index in |cities|
+};
+
+// The tour as a two-level list: a list of about sqrt(N) segments, each of which is a run of cities with a reverse bit.
+// The cities never move. Each segment is a range of |cities| (fixed after rebuild()), and the tour order is
+// given by the order of the segments and their reverse bits.
+// flip() splits at most two segments at the ends of the path and reverses the order of the segments in between
+// (toggling their bits), so it is O(sqrt(N)) instead of O(N). The segments get smaller with every split,
+// so the list is rebuilt into sqrt(N) equal segments once there are twice as many (amortized O(sqrt(N)) too).
+class TwoLevelList
+{
+public:
+    explicit TwoLevelList(const std::vector<int> &tour);
+
+    int size() const
+    {
+        return cities.size();
+    }
+
+    int next(const int &city) const
+    {
+        const Segment &segment = segments[segment_of[positions[city]]];
+        int position = positions[city];
+        if (segment.reversed ? position > segment.begin : position + 1 < segment.end)
+        {
+            return cities[segment.reversed ? position - 1 : position + 1];
+        }
+        return get_first(order[segment.rank + 1 == (int)order.size() ? 0 : segment.rank + 1]);
+    }
+
+    int prev(const int &city) const
+    {
+        const Segment &segment = segments[segment_of[positions[city]]];
+        int position = positions[city];
+        if (segment.reversed ? position + 1 < segment.end : position > segment.begin)
+        {
+            return cities[segment.reversed ? position + 1 : position - 1];
+        }
+        return get_last(order[segment.rank == 0 ? order.size() - 1 : segment.rank - 1]);
+    }
+
+    bool between(const int &a, const int &b, const int &c) const;
+    void flip(const int &a, const int &b, const int &c, const int &d);
+    std::vector<int> to_vector() const;
+
+private:
+    struct Segment
+    {
+        int begin, end;        // the range of |cities| in this segment
+        bool reversed = false; // whether the cities are visited from end - 1 down to begin
+        int rank = 0;          // index in |order|
+    };
+
+    // The first and the last city of the segment in the tour order.
+    int get_first(const int &segment) const
+    {
+        return segments[segment].reversed ? cities[segments[segment].end - 1] : cities[segments[segment].begin];
+    }
+    int get_last(const int &segment) const
+    {
+        return segments[segment].reversed ? cities[segments[segment].begin] : cities[segments[segment].end - 1];
+    }
+
+    // (rank of the segment, index in the segment) of |city|, which increases along the tour from get_first(order[0]).
+    std::pair<int, int> get_key(const int &city) const;
+
+    void split_before(const int &city);
+    void rebuild(const std::vector<int> &tour);
+
+    int segment_size = 1;
+    std::vector<int> cities;       // cities grouped by segment
+    std::vector<int> positions;    // city -> index in |cities|
+    std::vector<int> segment_of;   // index in |cities| -> segment
+    std::vector<Segment> segments; // segments (in no particular order)
+    std::vector<int> order;        // segments in the tour order
+};
@@ -63,35 +63,6 @@ bool check_tour(std::vector<int> tour, const int &num_of_cities)
     return true;
 }
 
-// Returns a two-dimensional vector of distances between two cities.
-// |cities|: a vector of coordinate of cities.
-std::vector<std::vector<double>> get_distances(const std::vector<City> &cities)
-{
-    int num_of_cities = cities.size();
-    std::vector<std::vector<double>> distances =
-        std::vector<std::vector<double>>(num_of_cities, std::vector<double>(num_of_cities, 0.0));
-    for (int i = 0; i < num_of_cities; ++i)
-    {
-        for (int j = 0; j < num_of_cities; ++j)
-        {
-            distances[i][j] = std::sqrt(
-                (cities[i].x - cities[j].x) * (cities[i].x - cities[j].x) + (cities[i].y - cities[j].y) * (cities[i].y - cities[j].y));
-        }
-    }
-    return distances;
-}
-
-// Returns the score(total distance) of |tour|.
-double get_score(const std::vector<int> &tour, const std::vector<std::vector<double>> &distances)
-{
-    double score = 0.0;
-    for (int i = 0; i < tour.size(); ++i)
-    {
-        score += distances[tour[i]][tour[(i + 1) % tour.size()]];
-    }
-    return score;
-}
-
 // Generates two random integers in [0, num_of_cities).
 // The first integer is smaller than the second one.
 std::pair<int, int> gen_random_indices(const int &num_of_cities, std::mt19937 &random_engine)
@@ -25,6 +25,4 @@ struct City
 std::vector<City> read_input(const std::string &);
 void print_tour(const std::string &, const std::vector<int> &);
 bool check_tour(std::vector<int>, const int &);
-std::vector<std::vector<double>> get_distances(const std::vector<City> &);
-double get_score(const std::vector<int> &, const std::vector<std::vector<double>> &);
 std::pair<int, int> gen_random_indices(const int &, std::mt19937 &);
\ No newline at end of file